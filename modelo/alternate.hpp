@@ -0,0 +1,248 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include <gurobi_c++.h>
+#include "graph.hpp"
+#include "interrupts.hpp"
+#include "memory.hpp"
+#include "repair.hpp"
+#include "termination.hpp"
+#include "tour.hpp"
+#include "vertex.hpp"
+
+
+/**
+ * Cheapest tour in one space sharing at least `k` edges with a fixed tour of the other.
+ *
+ * Uses a `graph` without the similarity constraint, with the fixed tour's edges fixed by their
+ * bounds. The count of shared edges is priced with a Lagrangian bonus on the fixed tour's
+ * edges, searched by bisection: each price is a plain TSP solve, giving a lower bound and,
+ * when it shares enough edges, a feasible tour. If the bounds do not meet, the count goes in
+ * as a linear row, which is exact since the other tour is known.
+ */
+struct fixed_tour final {
+public:
+    struct result final {
+        tour other;
+        /** Cost of `other`, in its own space. */
+        double cost;
+        unsigned shared;
+        /** Lower bound on the cost of the best `other`. */
+        double bound;
+        /** Last Lagrangian bonus tried. */
+        double bonus;
+        /** MIP solves used. */
+        unsigned solves;
+        /** Whether `other` was proven optimal. */
+        bool exact;
+    };
+
+    /** Bisection steps on the bonus before the exact solve. */
+    static constexpr unsigned MAX_STEPS = 6;
+
+private:
+    std::span<const vertex> vertices;
+    graph model;
+
+    using clock = std::chrono::steady_clock;
+
+public:
+    [[gnu::cold]]
+    fixed_tour(std::span<const vertex> vertices, const GRBEnv& env): vertices(vertices), model(vertices, env, 0) { }
+
+    /**
+     * Best tour in space `1 - fixed` given `given` in space `fixed`, or nothing when none was
+     * found in `seconds`.
+     */
+    [[gnu::cold]]
+    std::optional<result> solve(uint8_t fixed, const tour& given, unsigned k, memory_guard& guard, std::optional<double> seconds = std::nullopt) {
+        const uint8_t j = 1 - fixed;
+        const unsigned n = (unsigned) this->vertices.size();
+        const double fixed_cost = given.cost(fixed, this->vertices);
+        const auto start = clock::now();
+        const auto remaining = [&]() -> std::optional<double> {
+            if (!seconds) {
+                return std::nullopt;
+            }
+            const std::chrono::duration<double> spent = clock::now() - start;
+            return std::max(*seconds - spent.count(), 0.);
+        };
+
+        this->model.release_edges();
+        for (unsigned idx = 0; idx < n; idx++) {
+            this->model.fix_edge(fixed, given[idx], given[(idx + 1) % n]);
+        }
+
+        std::optional<result> best;
+        double bound = -INFINITY;
+        unsigned solves = 0;
+
+        // shared edges of the tour found with this bonus, if any
+        const auto attempt = [&](double bonus) -> std::optional<unsigned> {
+            auto control = termination();
+            this->model.time_limit(remaining());
+            try {
+                this->model.solve(control, guard);
+            } catch (const utils::invalid_solution&) {
+                return std::nullopt;
+            }
+            solves++;
+            bound = std::max(bound, this->model.bound() - fixed_cost + bonus * k);
+
+            auto other = this->model.tour(j);
+            const unsigned shared = tour::shared(given, other, n);
+            const double cost = other.cost(j, this->vertices);
+            if (shared >= k && (!best || cost < best->cost)) {
+                best = result { std::move(other), cost, shared, bound, bonus, 0, false };
+            }
+            return shared;
+        };
+        // costs are integers, so a gap below 1 is closed
+        const auto closed = [&]() {
+            return best && best->cost - bound < 1 - 1e-6;
+        };
+
+        double lo = 0.0, hi = 1.0;
+        for (unsigned idx = 0; idx < n; idx++) {
+            hi = std::max(hi, this->vertices[given[idx]][j].cost(this->vertices[given[(idx + 1) % n]][j]) + 1);
+        }
+        double bonus = 0.0;
+        this->model.price_edges(j, given, bonus);
+        auto shared = attempt(bonus);
+        for (unsigned step = 0; step < MAX_STEPS && shared && *shared < k && !closed(); step++) {
+            bonus = (lo + hi) / 2;
+            this->model.price_edges(j, given, bonus);
+            shared = attempt(bonus);
+            if (shared && *shared >= k) {
+                hi = bonus;
+            } else {
+                lo = bonus;
+            }
+        }
+
+        this->model.price_edges(j, given, 0.0);
+        if (!closed() && remaining().value_or(1.0) > 0) {
+            this->model.require_shared(j, given, k);
+            if (best) {
+                auto tours = utils::pair<tour>();
+                tours[fixed] = given;
+                tours[j] = best->other;
+                this->model.set_start(tours);
+            }
+            auto control = termination();
+            try {
+                this->model.time_limit(remaining());
+                this->model.solve(control, guard);
+                solves++;
+                bound = std::max(bound, this->model.bound() - fixed_cost);
+
+                auto other = this->model.tour(j);
+                const double cost = other.cost(j, this->vertices);
+                if (!best || cost < best->cost) {
+                    best = result { std::move(other), cost, tour::shared(given, other, n), bound, 0.0, 0, false };
+                }
+            } catch (const utils::invalid_solution&) {
+                // out of time: keep what the bisection found
+            }
+            this->model.require_shared(j, given, std::nullopt);
+        }
+        this->model.release_edges();
+
+        if (best) {
+            best->bound = bound;
+            best->solves = solves;
+            best->exact = closed();
+        }
+        return best;
+    }
+};
+
+
+/**
+ * Alternating optimization: fixes one tour and finds the best other one with `fixed_tour`,
+ * then swaps roles, until neither side improves. Every step keeps at least `k` shared edges,
+ * so the pair stays feasible, and with exact steps its cost never increases.
+ */
+struct alternating final {
+public:
+    struct step final {
+        /** Seconds since the start. */
+        double secs;
+        /** Space of the tour kept fixed. */
+        uint8_t fixed;
+        double cost;
+        unsigned shared;
+        unsigned solves;
+        bool exact;
+    };
+
+    /** Steps without improvement before stopping; one per side. */
+    static constexpr unsigned PATIENCE = 2;
+
+private:
+    std::span<const vertex> vertices;
+    unsigned k;
+    fixed_tour solver;
+    std::vector<step> history;
+
+    using clock = std::chrono::steady_clock;
+
+public:
+    [[gnu::cold]]
+    alternating(std::span<const vertex> vertices, const GRBEnv& env, unsigned k):
+        vertices(vertices), k(k), solver(vertices, env)
+    { }
+
+    /**
+     * Improves `tours`, which must share at least `k` edges, until converged, `max_steps` or
+     * `seconds` run out. Starts from `similarity_repair::construct` when empty.
+     */
+    [[gnu::cold]]
+    utils::pair<tour> run(memory_guard& guard, std::optional<utils::pair<tour>> start, std::optional<double> seconds, unsigned max_steps = 32) {
+        const auto begin = clock::now();
+        const auto elapsed = [&begin]() {
+            const std::chrono::duration<double> secs = clock::now() - begin;
+            return secs.count();
+        };
+
+        auto tours = start ? std::move(*start) : similarity_repair::construct(this->vertices, this->k);
+        double cost = tours[0].cost(0, this->vertices) + tours[1].cost(1, this->vertices);
+
+        unsigned stale = 0;
+        for (unsigned idx = 0; idx < max_steps && stale < PATIENCE && !interrupts::stop; idx++) {
+            const uint8_t fixed = idx % 2;
+            const auto left = seconds ? std::optional(*seconds - elapsed()) : std::nullopt;
+            if (left && *left <= 0) {
+                break;
+            }
+
+            const auto found = this->solver.solve(fixed, tours[fixed], this->k, guard, left);
+            if (!found) [[unlikely]] {
+                break;
+            }
+            const double next = tours[fixed].cost(fixed, this->vertices) + found->cost;
+            if (next < cost - 1e-6) {
+                tours[1 - fixed] = found->other;
+                cost = next;
+                stale = 0;
+            } else {
+                stale++;
+            }
+            this->history.push_back(step { elapsed(), fixed, cost, found->shared, found->solves, found->exact });
+        }
+        return tours;
+    }
+
+    /** Steps taken, with the pair cost after each one. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline const std::vector<step>& steps() const noexcept {
+        return this->history;
+    }
+};
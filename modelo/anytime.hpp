@@ -0,0 +1,302 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "results.hpp"
+#include "termination.hpp"
+
+
+/**
+ * Incumbent and bound of a solve over time, kept only where either improves.
+ *
+ * Written by `modelo` as a single `secs:best:bound` list separated by commas, so that it survives
+ * as one field of the result store. A missing incumbent or bound is written as `-`.
+ */
+struct trajectory final {
+public:
+    struct sample final {
+        double secs;
+        std::optional<double> best;
+        std::optional<double> bound;
+    };
+
+    /** Relative bound improvement worth a new sample, so tailing-off bounds stay short. */
+    static constexpr double RESOLUTION = 1e-4;
+
+private:
+    std::vector<sample> samples;
+
+    /** The value, unless it is Gurobi's infinity or beyond. */
+    [[gnu::const]] [[gnu::hot]] [[gnu::nothrow]]
+    static inline std::optional<double> known(double value) noexcept {
+        return termination::known(value) ? std::optional(value) : std::nullopt;
+    }
+
+    /** Primal or dual gap of `value` to `reference`, in [0, 1], as in the primal integral. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    static double gap(std::optional<double> value, std::optional<double> reference) noexcept {
+        if (!value || !reference) {
+            return 1.0;
+        }
+        if (*value == 0 && *reference == 0) {
+            return 0.0;
+        }
+        if (*value * *reference < 0) {
+            return 1.0;
+        }
+        return std::min(std::abs(*value - *reference) / std::max(std::abs(*value), std::abs(*reference)), 1.0);
+    }
+
+    /** Integral over `[0, horizon]` of the gap of the value taken from each sample. */
+    template <typename Take> [[gnu::pure]] [[gnu::hot]]
+    double integral(std::optional<double> reference, double horizon, Take&& take) const {
+        double area = 0.0, since = 0.0, current = 1.0;
+        for (const auto& point : this->samples) {
+            const double until = std::min(point.secs, horizon);
+            area += current * std::max(until - since, 0.0);
+            since = std::max(since, until);
+            current = gap(take(point), reference);
+        }
+        return area + current * std::max(horizon - since, 0.0);
+    }
+
+    [[gnu::cold]]
+    static std::optional<std::optional<double>> parse_value(std::string_view text) {
+        if (text == "-") {
+            return std::optional<double>();
+        }
+        if (auto value = utils::parse_double(text)) {
+            return known(*value);
+        }
+        return std::nullopt;
+    }
+
+public:
+    /** Adds the state reported by the solver, with infinities for a missing incumbent or bound. */
+    [[gnu::hot]]
+    void add(double secs, double best, double bound) {
+        const auto point = sample { secs, known(best), known(bound) };
+        if (!this->samples.empty()) [[likely]] {
+            const auto& last = this->samples.back();
+            const bool better = point.best && (!last.best || *point.best < *last.best);
+            const bool tighter = point.bound && (!last.bound
+                || *point.bound > *last.bound + RESOLUTION * std::max(std::abs(*last.bound), 1.0));
+            if (!better && !tighter) {
+                return;
+            }
+        }
+        this->samples.push_back(point);
+    }
+
+    /** Adds the final state, improved or not, so the trajectory spans the whole solve. */
+    [[gnu::cold]]
+    void finish(double secs, std::optional<double> best, std::optional<double> bound) {
+        this->samples.push_back(sample { secs, best ? known(*best) : best, bound ? known(*bound) : bound });
+    }
+
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline bool empty() const noexcept {
+        return this->samples.empty();
+    }
+
+    /** Time of the last sample, usually the end of the solve. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline double duration() const noexcept {
+        return this->samples.empty() ? 0.0 : this->samples.back().secs;
+    }
+
+    /** Last incumbent, if any was found. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline std::optional<double> final_cost() const noexcept {
+        return this->samples.empty() ? std::nullopt : this->samples.back().best;
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    std::optional<double> first_incumbent() const {
+        for (const auto& point : this->samples) {
+            if (point.best) {
+                return point.secs;
+            }
+        }
+        return std::nullopt;
+    }
+
+    /** First time the incumbent is within `tolerance` of `reference`, relatively. */
+    [[gnu::pure]] [[gnu::cold]]
+    std::optional<double> time_within(std::optional<double> reference, double tolerance) const {
+        for (const auto& point : this->samples) {
+            if (point.best && reference && gap(point.best, reference) <= tolerance) {
+                return point.secs;
+            }
+        }
+        return std::nullopt;
+    }
+
+    /** Primal integral up to `horizon`, the last incumbent held until then. In seconds. */
+    [[gnu::pure]] [[gnu::cold]]
+    double primal_integral(std::optional<double> reference, double horizon) const {
+        return this->integral(reference, horizon, [](const sample& point) { return point.best; });
+    }
+
+    /** Same as `primal_integral`, but on the bound. */
+    [[gnu::pure]] [[gnu::cold]]
+    double dual_integral(std::optional<double> reference, double horizon) const {
+        return this->integral(reference, horizon, [](const sample& point) { return point.bound; });
+    }
+
+    /**
+     * Parses the format written by `operator<<`, or nothing if any sample is malformed.
+     * Infinities, as written before `-`, are read as missing too.
+     */
+    [[gnu::cold]]
+    static std::optional<trajectory> parse(const std::string& text) {
+        auto result = trajectory();
+        auto items = std::istringstream(text);
+        std::string item;
+        while (std::getline(items, item, ',')) {
+            const auto first = item.find(':');
+            const auto second = item.find(':', first + 1);
+            if (first == std::string::npos || second == std::string::npos) [[unlikely]] {
+                return std::nullopt;
+            }
+            const auto secs = utils::parse_double(std::string_view(item).substr(0, first));
+            const auto best = parse_value(std::string_view(item).substr(first + 1, second - first - 1));
+            const auto bound = parse_value(std::string_view(item).substr(second + 1));
+            if (!secs || !best || !bound) [[unlikely]] {
+                return std::nullopt;
+            }
+            result.samples.push_back(sample { *secs, *best, *bound });
+        }
+        return result;
+    }
+
+    [[gnu::cold]]
+    friend std::ostream& operator<<(std::ostream& os, const trajectory& path) {
+        const auto precision = os.precision(10);
+        const auto value = [&os](std::optional<double> x) -> std::ostream& {
+            return x ? (os << *x) : (os << '-');
+        };
+        for (size_t i = 0; i < path.samples.size(); i++) {
+            const auto& point = path.samples[i];
+            os << (i > 0 ? "," : "") << point.secs << ':';
+            value(point.best) << ':';
+            value(point.bound);
+        }
+        os.precision(precision);
+        return os;
+    }
+};
+
+
+/**
+ * Anytime comparison of configurations on the same instances.
+ *
+ * Each instance gets a common reference, the best cost found by any configuration, and a common
+ * horizon, the longest of its solves, so that integrals of different runs are comparable. Only
+ * instances run by every configuration are counted.
+ */
+struct anytime_study final {
+public:
+    struct row final {
+        std::string label;
+        size_t instances;
+        double primal_integral;
+        double dual_integral;
+        /** Mean over the instances where it happened, and how many they were. */
+        double first_incumbent;
+        size_t found;
+        double within;
+        size_t reached;
+    };
+
+    /** Relative distance to the reference for `within`. */
+    static constexpr double TOLERANCE = 0.01;
+
+private:
+    /** Trajectories by instance and configuration. */
+    std::map<std::string, std::map<std::string, trajectory>> runs;
+    std::vector<std::string> labels;
+
+public:
+    [[gnu::cold]]
+    void add(const std::string& instance, const std::string& label, trajectory path) {
+        if (std::find(this->labels.begin(), this->labels.end(), label) == this->labels.end()) {
+            this->labels.push_back(label);
+        }
+        this->runs[instance][label] = std::move(path);
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    std::vector<row> rows() const {
+        auto rows = std::vector<row>();
+        for (const auto& label : this->labels) {
+            rows.push_back(row { label, 0, 0.0, 0.0, 0.0, 0, 0.0, 0 });
+        }
+
+        for (const auto& [_, paths] : this->runs) {
+            if (paths.size() != this->labels.size()) {
+                continue;
+            }
+            std::optional<double> reference;
+            double horizon = 0.0;
+            for (const auto& [_, path] : paths) {
+                if (const auto cost = path.final_cost(); cost && (!reference || *cost < *reference)) {
+                    reference = cost;
+                }
+                horizon = std::max(horizon, path.duration());
+            }
+
+            for (auto& row : rows) {
+                const auto& path = paths.at(row.label);
+                row.instances++;
+                row.primal_integral += path.primal_integral(reference, horizon);
+                row.dual_integral += path.dual_integral(reference, horizon);
+                if (auto secs = path.first_incumbent()) {
+                    row.first_incumbent += *secs;
+                    row.found++;
+                }
+                if (auto secs = path.time_within(reference, TOLERANCE)) {
+                    row.within += *secs;
+                    row.reached++;
+                }
+            }
+        }
+
+        for (auto& row : rows) {
+            row.primal_integral /= std::max<size_t>(row.instances, 1);
+            row.dual_integral /= std::max<size_t>(row.instances, 1);
+            row.first_incumbent /= std::max<size_t>(row.found, 1);
+            row.within /= std::max<size_t>(row.reached, 1);
+        }
+        return rows;
+    }
+
+    [[gnu::cold]]
+    friend std::ostream& operator<<(std::ostream& os, const anytime_study& study) {
+        const auto rows = study.rows();
+        const row *best = nullptr;
+        for (const auto& row : rows) {
+            os << "Anytime: " << row.label << std::endl;
+            os << "    Instances: " << row.instances << std::endl;
+            os << "    Primal integral: " << row.primal_integral << " secs" << std::endl;
+            os << "    Dual integral: " << row.dual_integral << " secs" << std::endl;
+            os << "    First incumbent: " << row.first_incumbent << " secs (" << row.found << " of " << row.instances << ")" << std::endl;
+            os << "    Within " << 100 * TOLERANCE << "%: " << row.within << " secs (" << row.reached << " of " << row.instances << ")" << std::endl;
+            if (row.instances > 0 && (!best || row.primal_integral < best->primal_integral)) {
+                best = &row;
+            }
+        }
+        if (best) {
+            os << "Best primal integral: " << best->label << std::endl;
+        }
+        return os;
+    }
+};
@@ -0,0 +1,501 @@
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "anytime.hpp"
+#include "generator.hpp"
+#include "schedule.hpp"
+#include "results.hpp"
+#include "scaling.hpp"
+#include "selector.hpp"
+#include "variability.hpp"
+#include "coordinates.hpp"
+#include "argparse.hpp"
+
+
+struct program final {
+private:
+    argparse::ArgumentParser args;
+
+    [[gnu::cold]]
+    explicit inline program(std::string name): args(name) {
+        this->args.add_argument("-n", "--nodes")
+            .help("instance sizes in the grid (repeatable)")
+            .default_value(std::vector<unsigned>{ 100, 150, 200, 250 })
+            .append()
+            .scan<'u', unsigned>();
+
+        this->args.add_argument("-r", "--ratios")
+            .help("similarity as a fraction of the instance size (repeatable)")
+            .default_value(std::vector<double>{ 0.0, 0.5, 1.0 })
+            .append()
+            .scan<'g', double>();
+
+        this->args.add_argument("-s", "--slots")
+            .help("number of concurrent solves")
+            .default_value<unsigned>(1)
+            .scan<'u', unsigned>();
+
+        this->args.add_argument("--timeout")
+            .help("timeout for each solve (in minutes)")
+            .default_value<double>(30.0)
+            .scan<'g', double>();
+
+        this->args.add_argument("--modelo")
+            .help("path to the solver executable")
+            .default_value(std::string("./modelo"));
+
+        this->args.add_argument("--args")
+            .help("extra arguments for each solve, as a single string")
+            .default_value(std::string(""));
+
+        this->args.add_argument("--store")
+            .help("result store with the history of past runs")
+            .default_value(std::string("results.txt"));
+
+        this->args.add_argument("--retrain")
+            .help("fit the engine selection rules on the result store, write them to this file and exit");
+
+        this->args.add_argument("--scaling")
+            .help("strong scaling: run the grid once per thread count and report speedup and efficiency")
+            .default_value(false)
+            .implicit_value(true);
+
+        this->args.add_argument("--threads")
+            .help("thread counts for --scaling (repeatable), powers of two up to the cores by default")
+            .default_value(std::vector<unsigned>{})
+            .append()
+            .scan<'u', unsigned>();
+
+        this->args.add_argument("--growth")
+            .help("size scaling: run random instances of each --nodes size, growing until a run fails, and fit growth exponents")
+            .default_value(false)
+            .implicit_value(true);
+
+        this->args.add_argument("--seed")
+            .help("seed for the random instances of --growth")
+            .default_value<unsigned>(1)
+            .scan<'u', unsigned>();
+
+        this->args.add_argument("--anytime")
+            .help("anytime quality: run the grid once per --compare configuration and compare primal and dual integrals")
+            .default_value(false)
+            .implicit_value(true);
+
+        this->args.add_argument("--compare")
+            .help("extra arguments of a configuration for --anytime and --variability (repeatable), only --args by default")
+            .default_value(std::vector<std::string>{})
+            .append();
+
+        this->args.add_argument("--variability")
+            .help("performance variability: run the grid with several solver seeds per --compare configuration, --slots at a time")
+            .default_value(false)
+            .implicit_value(true);
+
+        this->args.add_argument("--seeds")
+            .help("solver seeds for each instance and configuration in --variability")
+            .default_value<unsigned>(5)
+            .scan<'u', unsigned>();
+
+        this->args.add_argument("--dry-run")
+            .help("only show the predicted schedule")
+            .default_value(false)
+            .implicit_value(true);
+    }
+
+public:
+    [[gnu::cold]]
+    explicit program(const std::vector<std::string>& arguments): program(arguments[0]) {
+        try {
+            this->args.parse_args(arguments);
+
+        } catch (const std::runtime_error& err) {
+            std::cerr << err.what() << std::endl;
+            std::cerr << this->args << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    [[gnu::cold]]
+    std::vector<job> grid() const {
+        auto jobs = std::vector<job>();
+
+        for (unsigned n : this->args.get<std::vector<unsigned>>("nodes")) {
+            if (n > DEFAULT_VERTICES.size()) [[unlikely]] {
+                throw utils::not_enough_items::in(DEFAULT_VERTICES, n);
+            }
+            const auto vertices = std::span(DEFAULT_VERTICES).first(n);
+
+            for (double ratio : this->args.get<std::vector<double>>("ratios")) {
+                const auto k = (unsigned) std::round(std::clamp(ratio, 0.0, 1.0) * n);
+                jobs.emplace_back(vertices, k, this->args.get<std::string>("args"));
+            }
+        }
+        return jobs;
+    }
+
+    [[gnu::cold]]
+    void retrain(const result_store& store, const std::string& path) const {
+        const auto records = store.load();
+        const auto selector = engine_selector::train(records, DEFAULT_VERTICES);
+
+        auto file = std::ofstream(path);
+        selector.save(file);
+        std::cout << "History: " << records.size() << " run(s)" << std::endl;
+        std::cout << "Engines trained: " << selector.size() << std::endl;
+        if (selector.size() < 2) [[unlikely]] {
+            std::cout << "Too few engines for trained rules, modelo will keep the built-in ones." << std::endl;
+        }
+    }
+
+    [[gnu::cold]]
+    std::vector<unsigned> thread_counts() const {
+        auto counts = this->args.get<std::vector<unsigned>>("threads");
+        if (counts.empty()) {
+            const unsigned cores = std::max(std::thread::hardware_concurrency(), 1U);
+            for (unsigned threads = 1; threads < cores; threads *= 2) {
+                counts.push_back(threads);
+            }
+            counts.push_back(cores);
+        }
+        std::erase(counts, 0U);
+        std::sort(counts.begin(), counts.end());
+        counts.erase(std::unique(counts.begin(), counts.end()), counts.end());
+        return counts;
+    }
+
+    /** The grid with `extra` appended to the arguments of every job. */
+    [[gnu::cold]]
+    std::vector<job> with_args(const std::vector<job>& jobs, const std::string& extra) const {
+        auto result = jobs;
+        for (auto& job : result) {
+            job.args = job.args.empty() ? extra : (job.args + " " + extra);
+        }
+        return result;
+    }
+
+    /**
+     * Reruns the grid at each thread count. Solver components are measured one run at a time,
+     * with that many Gurobi threads; the batch itself runs the whole grid on that many slots,
+     * with one thread per solve.
+     */
+    [[gnu::cold]]
+    void scaling(const result_store& store) const {
+        const auto jobs = this->grid();
+        const auto counts = this->thread_counts();
+        const auto modelo = this->args.get<std::string>("modelo");
+        const double timeout = this->args.get<double>("timeout");
+
+        std::cout << "Thread counts:";
+        for (unsigned threads : counts) {
+            std::cout << " " << threads;
+        }
+        std::cout << std::endl;
+        std::cout << "Instances: " << jobs.size() << std::endl;
+        if (this->args.get<bool>("dry-run")) {
+            return;
+        }
+
+        auto study = scaling_study();
+        for (unsigned threads : counts) {
+            const auto single = scheduler(modelo, 1, timeout);
+            const auto records = single.run(this->with_args(jobs, "--threads " + std::to_string(threads)), store, std::cout);
+            for (size_t idx = 0; idx < jobs.size(); idx++) {
+                const auto& rec = records[idx];
+                if (rec.text("status") != "ok") [[unlikely]] {
+                    continue;
+                }
+                const auto engine = rec.text("engine").value_or("unknown");
+                const auto instance = jobs[idx].key();
+                for (const auto& [component, key] : { std::pair("total", "actual"), { "mip", "execution_time" }, { "heuristics", "heuristic_phase" }, { "separation", "separation_time" } }) {
+                    // zero means the component did not run, not that it took no time
+                    if (auto secs = rec.number(key); secs && *secs > 0) {
+                        study.add(engine + " " + component, instance, threads, *secs);
+                    }
+                }
+            }
+
+            const auto start = std::chrono::steady_clock::now();
+            scheduler(modelo, threads, timeout).run(this->with_args(jobs, "--threads 1"), store, std::cout);
+            const std::chrono::duration<double> makespan = std::chrono::steady_clock::now() - start;
+            study.add("batch", "grid", threads, makespan.count());
+        }
+        std::cout << study;
+    }
+
+    /**
+     * Runs random instances of increasing size for each ratio, one at a time, stopping a ratio
+     * at its first run that times out or fails. Then fits how each component grows with `n`.
+     */
+    [[gnu::cold]]
+    void growth(const result_store& store) const {
+        auto sizes = this->args.get<std::vector<unsigned>>("nodes");
+        std::sort(sizes.begin(), sizes.end());
+        const auto ratios = this->args.get<std::vector<double>>("ratios");
+        const unsigned seed = this->args.get<unsigned>("seed");
+        const double timeout = this->args.get<double>("timeout");
+        const auto single = scheduler(this->args.get<std::string>("modelo"), 1, timeout);
+        const auto args = this->args.get<std::string>("args") + " --generate --seed " + std::to_string(seed);
+
+        std::cout << "Sizes:";
+        for (unsigned n : sizes) {
+            std::cout << " " << n;
+        }
+        std::cout << std::endl;
+        if (this->args.get<bool>("dry-run")) {
+            return;
+        }
+
+        static constexpr std::array<std::pair<const char *, const char *>, 6> COMPONENTS = {{
+            { "build", "build_time" },
+            { "separation", "separation_time" },
+            { "heuristics", "heuristic_phase" },
+            { "mip", "execution_time" },
+            { "total", "actual" },
+            { "memory", "peak_memory" },
+        }};
+        auto study = growth_study();
+        auto engines = std::vector<std::string>();
+        for (double ratio : ratios) {
+            for (unsigned n : sizes) {
+                const auto k = (unsigned) std::round(std::clamp(ratio, 0.0, 1.0) * n);
+                const auto instance = utils::random_vertices(n, seed);
+                const auto rec = single.run({ job(instance, k, args) }, store, std::cout).front();
+                if (rec.text("status") != "ok") {
+                    std::cout << "Stopped at n=" << n << " k=" << k << ": " << rec.text("status").value_or("error") << std::endl;
+                    break;
+                }
+
+                const auto engine = rec.text("engine").value_or("unknown");
+                if (std::find(engines.begin(), engines.end(), engine) == engines.end()) {
+                    engines.push_back(engine);
+                }
+                for (const auto& [component, key] : COMPONENTS) {
+                    // zero means the component did not run, so it is left out of the fit
+                    if (auto value = rec.number(key); value && *value > 0) {
+                        study.add(engine + " " + component, n, *value);
+                    }
+                }
+                std::cout << "Run n=" << n << " k=" << k << ": " << rec.text("actual").value_or("?") << " secs, "
+                    << rec.text("peak_memory").value_or("?") << " MiB, gap " << rec.text("optimality_gap").value_or("?") << std::endl;
+            }
+        }
+
+        std::cout << study;
+        for (const auto& engine : engines) {
+            // a flat or noisy total says nothing about where the timeout is reached
+            if (const auto total = study.fitted(engine + " total"); total && total->r2 >= 0.5 && timeout > 0) {
+                std::cout << "Viable up to: n=" << std::floor(total->reach(timeout * 60)) << " for " << engine << " within the timeout" << std::endl;
+            }
+            // only components measured on two sizes or more are fitted, and so candidates
+            std::optional<std::pair<std::string, double>> steepest;
+            for (const char *component : { "build", "separation", "heuristics" }) {
+                const auto fit = study.fitted(engine + " " + component);
+                if (fit && (!steepest || fit->exponent > steepest->second)) {
+                    steepest = std::pair(std::string(component), fit->exponent);
+                }
+            }
+            if (steepest) {
+                std::cout << "Next to optimize: " << engine << " " << steepest->first << " (n^" << steepest->second << ")" << std::endl;
+            }
+        }
+    }
+
+    /** Configurations given by --compare, or just the --args when none is. */
+    [[gnu::cold]]
+    std::vector<std::string> configurations() const {
+        auto configs = this->args.get<std::vector<std::string>>("compare");
+        if (configs.empty()) {
+            configs.emplace_back();
+        }
+        return configs;
+    }
+
+    /** Engine of a run, with the extra arguments of its configuration. */
+    [[gnu::pure]] [[gnu::cold]]
+    static std::string label(const record& rec, const std::string& config) {
+        const auto engine = rec.text("engine").value_or("unknown");
+        const auto extra = config.substr(std::min(config.find_first_not_of(' '), config.size()));
+        return extra.empty() ? engine : (engine + " [" + extra + "]");
+    }
+
+    /**
+     * Runs the grid for each configuration and compares them on the trajectories reported by
+     * `modelo`, against the best cost any of them found on each instance.
+     */
+    [[gnu::cold]]
+    void anytime(const result_store& store) const {
+        const auto jobs = this->grid();
+        const auto configs = this->configurations();
+        const auto sched = scheduler(
+            this->args.get<std::string>("modelo"),
+            this->args.get<unsigned>("slots"),
+            this->args.get<double>("timeout")
+        );
+
+        std::cout << "Configurations: " << configs.size() << std::endl;
+        std::cout << "Instances: " << jobs.size() << std::endl;
+        if (this->args.get<bool>("dry-run")) {
+            return;
+        }
+
+        auto study = anytime_study();
+        for (const auto& config : configs) {
+            const auto runs = config.empty() ? jobs : this->with_args(jobs, config);
+            const auto records = sched.run(runs, store, std::cout);
+            for (size_t idx = 0; idx < jobs.size(); idx++) {
+                const auto& rec = records[idx];
+                auto path = trajectory::parse(rec.text("trajectory").value_or(""));
+                if (rec.text("status") == "timeout" && (!path || path->empty())) {
+                    // killed before reporting: no incumbent nor bound for the whole run
+                    path.emplace().finish(rec.number("actual").value_or(0.0), std::nullopt, std::nullopt);
+                }
+                if (rec.text("status") == "error" || !path || path->empty()) [[unlikely]] {
+                    continue;
+                }
+                study.add(jobs[idx].key(), label(rec, config), *path);
+            }
+        }
+        std::cout << study;
+    }
+
+    /**
+     * Runs every instance and configuration once per solver seed, all of them sharing `--slots`
+     * concurrent solves, with the cores split evenly between the slots so the thread budget is
+     * the same for every run. Timeouts count as the full timeout.
+     */
+    [[gnu::cold]]
+    void variability(const result_store& store) const {
+        const auto jobs = this->grid();
+        const auto configs = this->configurations();
+        const unsigned seeds = std::max(this->args.get<unsigned>("seeds"), 1U);
+        const double timeout = this->args.get<double>("timeout");
+        const auto sched = scheduler(this->args.get<std::string>("modelo"), this->args.get<unsigned>("slots"), timeout);
+        const unsigned threads = std::max(std::thread::hardware_concurrency() / sched.slots, 1U);
+
+        // every run in a single schedule, remembering where each one came from
+        auto runs = std::vector<job>();
+        auto origin = std::vector<std::tuple<size_t, size_t, unsigned>>();
+        for (size_t c = 0; c < configs.size(); c++) {
+            for (unsigned seed = 1; seed <= seeds; seed++) {
+                const auto extra = configs[c] + " --threads " + std::to_string(threads) + " --solver-seed " + std::to_string(seed);
+                for (const auto& job : this->with_args(jobs, extra)) {
+                    origin.emplace_back(runs.size() % jobs.size(), c, seed);
+                    runs.push_back(job);
+                }
+            }
+        }
+
+        std::cout << "Configurations: " << configs.size() << std::endl;
+        std::cout << "Instances: " << jobs.size() << std::endl;
+        std::cout << "Seeds: " << seeds << std::endl;
+        std::cout << "Threads per run: " << threads << " (" << sched.slots << " slot(s))" << std::endl;
+        if (this->args.get<bool>("dry-run")) {
+            return;
+        }
+
+        auto study = variability_study();
+        const auto records = sched.run(runs, store, std::cout);
+        for (size_t idx = 0; idx < runs.size(); idx++) {
+            const auto& rec = records[idx];
+            const auto [instance, config, seed] = origin[idx];
+            if (rec.text("status") == "ok") [[likely]] {
+                study.add(jobs[instance].key(), label(rec, configs[config]), seed, rec.number("actual").value_or(0.0));
+            } else if (rec.text("status") == "timeout") {
+                study.add(jobs[instance].key(), label(rec, configs[config]), seed, timeout * 60);
+            }
+        }
+        std::cout << study;
+    }
+
+    [[gnu::cold]]
+    void run() const {
+        const auto store = result_store(this->args.get<std::string>("store"));
+        if (auto path = this->args.present<std::string>("retrain")) {
+            this->retrain(store, *path);
+            return;
+        }
+        if (this->args.get<bool>("scaling")) {
+            this->scaling(store);
+            return;
+        }
+        if (this->args.get<bool>("growth")) {
+            this->growth(store);
+            return;
+        }
+        if (this->args.get<bool>("anytime")) {
+            this->anytime(store);
+            return;
+        }
+        if (this->args.get<bool>("variability")) {
+            this->variability(store);
+            return;
+        }
+        const auto model = runtime_model(store.load());
+        const auto sched = scheduler(
+            this->args.get<std::string>("modelo"),
+            this->args.get<unsigned>("slots"),
+            this->args.get<double>("timeout")
+        );
+
+        auto jobs = this->grid();
+        for (auto& job : jobs) {
+            job.predicted = model.predict(job);
+            if (sched.timeout > 0) {
+                job.predicted = std::min(job.predicted, sched.timeout * 60);
+            }
+        }
+        const double makespan = sched.plan(jobs);
+
+        std::cout << "History: " << model.size() << " run(s)" << std::endl;
+        std::cout << "Slots: " << sched.slots << std::endl;
+        std::cout << "Predicted makespan: " << makespan << " secs" << std::endl;
+        for (const auto& job : jobs) {
+            std::cout << "    " << job << ": " << job.predicted << " secs" << std::endl;
+        }
+        if (this->args.get<bool>("dry-run")) {
+            return;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto records = sched.run(jobs, store, std::cout);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        double error = 0.0;
+        size_t measured = 0;
+        for (const auto& rec : records) {
+            if (rec.text("status") == "error") [[unlikely]] {
+                continue;
+            }
+            measured++;
+            const double predicted = rec.number("predicted").value_or(1.0);
+            const double actual = rec.number("actual").value_or(predicted);
+            error += std::abs(std::log(std::max(actual, 1e-3) / std::max(predicted, 1e-3)));
+        }
+        std::cout << "Actual makespan: " << elapsed.count() << " secs" << std::endl;
+        std::cout << "Mean prediction error: " << std::exp(error / std::max<size_t>(measured, 1)) << "x" << std::endl;
+    }
+};
+
+
+int main(int argc, const char * const argv[]) {
+    const program program(std::vector<std::string>(argv, argv + argc));
+
+    try {
+        program.run();
+
+    } catch (const std::exception& err) {
+        std::cerr << "std::exception: " << err.what() << std::endl;
+        return EXIT_FAILURE;
+
+    } catch (...) {
+        std::cerr << "unknown exception!" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <span>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "tour.hpp"
+#include "vertex.hpp"
+
+
+/** Subtour elimination sets separated so far, for each tour. */
+struct cut_pool final {
+public:
+    using key = std::pair<uint8_t, std::vector<unsigned>>;
+
+    struct entry final {
+        /** Separation round when the set was last found violated. */
+        uint64_t seen;
+        /** Number of times the set was found violated. */
+        uint64_t hits;
+    };
+
+private:
+    std::map<key, entry> items;
+    uint64_t tick = 0;
+    uint64_t last_shed = 0;
+    uint64_t found = 0;
+
+public:
+    /** Marks the start of a new separation round. */
+    [[gnu::hot]] [[gnu::nothrow]]
+    inline void next_round() noexcept {
+        this->tick++;
+    }
+
+    /** Records a violated subtour set, returning true when it was not in the pool yet. */
+    [[gnu::hot]]
+    bool add(uint8_t i, const tour& subtour) {
+        auto set = std::vector<unsigned>(subtour.begin(), subtour.end());
+        std::sort(set.begin(), set.end());
+        this->found++;
+
+        auto [it, inserted] = this->items.try_emplace(key(i, std::move(set)), entry { this->tick, 0 });
+        it->second.seen = this->tick;
+        it->second.hits++;
+        return inserted;
+    }
+
+    /**
+     * Drops the sets not found violated since the previous call, or the older half of the pool
+     * when every set is still active.
+     *
+     * Only the pool shrinks: the model rows `graph::keep_cuts` added for dropped sets are removed
+     * by `graph::shed_cuts`, between solves. Returns the number of sets removed.
+     */
+    [[gnu::cold]]
+    size_t shed() {
+        if (this->tick == this->last_shed) [[unlikely]] {
+            return 0;
+        }
+        const auto before = this->items.size();
+        std::erase_if(this->items, [this](const auto& item) {
+            return item.second.seen < this->last_shed;
+        });
+
+        if (this->items.size() == before && before > 1) {
+            auto ages = std::vector<uint64_t>();
+            ages.reserve(before);
+            for (const auto& [_, entry] : this->items) {
+                ages.push_back(entry.seen);
+            }
+            const auto median = ages.begin() + ages.size() / 2;
+            std::nth_element(ages.begin(), median, ages.end());
+
+            std::erase_if(this->items, [median](const auto& item) {
+                return item.second.seen < *median;
+            });
+        }
+
+        this->last_shed = this->tick;
+        return before - this->items.size();
+    }
+
+    /**
+     * Follows the removal of vertex `v` from a graph of `order` vertices, where the last vertex
+     * takes its position.
+     *
+     * Sets containing `v` are dropped, as are sets that would cover the whole remaining graph,
+     * which no longer describe a subtour. Returns the number of sets removed.
+     */
+    [[gnu::cold]]
+    size_t remove_vertex(unsigned v, unsigned order) {
+        const auto before = this->items.size();
+        const unsigned last = order - 1;
+
+        auto kept = std::map<key, entry>();
+        for (auto& [key, entry] : this->items) {
+            auto set = key.second;
+            if (std::binary_search(set.begin(), set.end(), v) || set.size() + 1 >= order) {
+                continue;
+            }
+            if (v != last && set.back() == last) {
+                set.back() = v;
+                std::sort(set.begin(), set.end());
+            }
+            kept.emplace(cut_pool::key(key.first, std::move(set)), entry);
+        }
+        this->items = std::move(kept);
+        return before - this->items.size();
+    }
+
+    /**
+     * Writes one set per line, as its tour followed by the ids of its vertices, so that another
+     * run over the same vertices can load it.
+     */
+    [[gnu::cold]]
+    void save(std::ostream& os, std::span<const vertex> vertices) const {
+        for (const auto& [key, _] : this->items) {
+            write(os, key, vertices);
+        }
+    }
+
+    /** Writes a single set in the format of `save`. */
+    [[gnu::cold]]
+    static void write(std::ostream& os, const key& set, std::span<const vertex> vertices) {
+        os << (unsigned) set.first;
+        for (unsigned v : set.second) {
+            os << ' ' << vertices[v].id();
+        }
+        os << '\n';
+    }
+
+    /**
+     * Reads sets written by `save`, as positions in `vertices`. Sets with unknown ids, or that
+     * cannot be violated by a tour over `vertices`, are skipped.
+     */
+    [[gnu::cold]]
+    static std::vector<key> load(std::istream& is, std::span<const vertex> vertices) {
+        auto position = std::unordered_map<unsigned, unsigned>();
+        for (unsigned v = 0; v < vertices.size(); v++) {
+            position.emplace(vertices[v].id(), v);
+        }
+
+        auto sets = std::vector<key>();
+        std::string line;
+        while (std::getline(is, line)) {
+            auto words = std::istringstream(line);
+            unsigned i = 0, id = 0;
+            if (!(words >> i) || i > 1) [[unlikely]] {
+                continue;
+            }
+            auto set = std::vector<unsigned>();
+            bool known = true;
+            while (known && words >> id) {
+                const auto found = position.find(id);
+                known = found != position.end();
+                if (known) [[likely]] {
+                    set.push_back(found->second);
+                }
+            }
+            if (known && set.size() >= 2 && set.size() + 2 <= vertices.size()) {
+                std::sort(set.begin(), set.end());
+                sets.emplace_back((uint8_t) i, std::move(set));
+            }
+        }
+        return sets;
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline bool contains(const key& set) const {
+        return this->items.contains(set);
+    }
+
+    /** Sets currently in the pool. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline size_t size() const noexcept {
+        return this->items.size();
+    }
+
+    /** Violated sets found over the whole search, including repeated ones. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline uint64_t total() const noexcept {
+        return this->found;
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline auto begin() const {
+        return this->items.begin();
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline auto end() const {
+        return this->items.end();
+    }
+};
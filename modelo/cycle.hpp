@@ -0,0 +1,164 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "tour.hpp"
+#include "vertex.hpp"
+
+
+/**
+ * Tour stored as an array of vertices plus the position of each one, for local search.
+ *
+ * Moves are given by the edges they remove, so they work the same regardless of the current
+ * orientation of the array.
+ */
+struct cycle final {
+private:
+    std::vector<unsigned> order;
+    std::vector<unsigned> pos;
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline unsigned wrap(unsigned idx) const noexcept {
+        return (idx >= this->size()) ? (idx - (unsigned) this->size()) : idx;
+    }
+
+    [[gnu::hot]] [[gnu::nothrow]]
+    inline void swap_at(unsigned i, unsigned j) noexcept {
+        std::swap(this->order[i], this->order[j]);
+        this->pos[this->order[i]] = i;
+        this->pos[this->order[j]] = j;
+    }
+
+    /** Reverses the positions from `i` forward to `j`, both inclusive. */
+    [[gnu::hot]] [[gnu::nothrow]]
+    void reverse_positions(unsigned i, unsigned j) noexcept {
+        const unsigned n = (unsigned) this->size();
+        unsigned len = this->wrap(j + n - i) + 1;
+
+        if (2 * len > n) {
+            // the complement gives the same cycle, with the other orientation
+            const unsigned first = this->wrap(j + 1);
+            j = this->wrap(i + n - 1);
+            i = first;
+            len = n - len;
+        }
+        for (unsigned step = 0; step < len / 2; step++) {
+            this->swap_at(i, j);
+            i = this->wrap(i + 1);
+            j = this->wrap(j + n - 1);
+        }
+    }
+
+public:
+    [[gnu::cold]]
+    explicit cycle(const tour& tour): order(tour.begin(), tour.end()), pos(tour.size()) {
+        for (unsigned i = 0; i < this->order.size(); i++) {
+            this->pos[this->order[i]] = i;
+        }
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline size_t size() const noexcept {
+        return this->order.size();
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline unsigned position(unsigned v) const noexcept {
+        return this->pos[v];
+    }
+
+    /** Vertices in tour order. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline std::span<const unsigned> sequence() const noexcept {
+        return this->order;
+    }
+
+    /** Position of each vertex in `sequence`. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline std::span<const unsigned> positions() const noexcept {
+        return this->pos;
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline unsigned at(unsigned idx) const noexcept {
+        return this->order[idx];
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline unsigned succ(unsigned v) const noexcept {
+        return this->order[this->wrap(this->pos[v] + 1)];
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline unsigned pred(unsigned v) const noexcept {
+        return this->order[this->wrap(this->pos[v] + (unsigned) this->size() - 1)];
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline bool adjacent(unsigned u, unsigned v) const noexcept {
+        return this->succ(u) == v || this->pred(u) == v;
+    }
+
+    /**
+     * Replaces edges `(a, a2)` and `(b, b2)` by `(a, b)` and `(a2, b2)`.
+     *
+     * Both must be edges of the tour, with `a2` and `b2` on the same side of `a` and `b`;
+     * returns false, without changes, otherwise.
+     */
+    [[gnu::hot]]
+    bool two_opt(unsigned a, unsigned a2, unsigned b, unsigned b2) noexcept {
+        if (this->succ(a) != a2) {
+            std::swap(a, a2);
+            std::swap(b, b2);
+        }
+        if (this->succ(a) != a2 || this->succ(b) != b2) [[unlikely]] {
+            return false;
+        }
+        this->reverse_positions(this->pos[a2], this->pos[b]);
+        return true;
+    }
+
+    /** Neighbours of `b` as `(p, nx)`, oriented so that `a -> a2` implies `p -> b -> nx`. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline std::pair<unsigned, unsigned> around(unsigned b, unsigned a, unsigned a2) const noexcept {
+        if (this->succ(a) == a2) {
+            return { this->pred(b), this->succ(b) };
+        } else {
+            return { this->succ(b), this->pred(b) };
+        }
+    }
+
+    /**
+     * Moves `b` between `a` and its neighbour `a2`, replacing `(a, a2)`, `(p, b)` and `(b, nx)`
+     * with `(a, b)`, `(b, a2)` and `(p, nx)`.
+     */
+    [[gnu::hot]]
+    bool or_opt(unsigned b, unsigned a, unsigned a2) noexcept {
+        const auto [p, nx] = this->around(b, a, a2);
+        if (b == a || b == a2 || nx == a || p == a) [[unlikely]] {
+            return false;
+        }
+        return this->two_opt(a, a2, p, b) && this->two_opt(a, p, b, nx);
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    tour to_tour() const {
+        auto result = tour();
+        result.assign(this->order.begin(), this->order.end());
+        return result;
+    }
+
+    /** Cost of the tour in space `i`. */
+    [[gnu::pure]] [[gnu::hot]]
+    inline double cost(uint8_t i, std::span<const vertex> vertices) const noexcept {
+        double total = 0.0;
+        for (unsigned v = 0; v < this->size(); v++) {
+            total += vertices[this->order[v]][i].cost(vertices[this->order[this->wrap(v + 1)]][i]);
+        }
+        return total;
+    }
+};
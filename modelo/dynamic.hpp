@@ -0,0 +1,237 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "graph.hpp"
+#include "memory.hpp"
+#include "repair.hpp"
+#include "termination.hpp"
+#include "tour.hpp"
+#include "vertex.hpp"
+
+
+namespace utils {
+    /**
+     * Reads batches of changes from `filename`, one change per line, with batches separated by
+     * blank lines. Each line starts with an operation character, and `parse` reads the rest.
+     */
+    template <typename Change> [[gnu::cold]]
+    static std::vector<std::vector<Change>> read_batches(const std::string& filename, auto&& parse) {
+        auto file = std::ifstream(filename);
+        if (!file) [[unlikely]] {
+            throw utils::invalid_file::is_empty_or_missing(filename);
+        }
+
+        auto batches = std::vector<std::vector<Change>>(1);
+        std::string line;
+        while (std::getline(file, line)) {
+            auto words = std::istringstream(line);
+            char op = 0;
+            if (!(words >> op)) {
+                if (!batches.back().empty()) {
+                    batches.emplace_back();
+                }
+                continue;
+            }
+
+            if (std::optional<Change> change = parse(op, words)) [[likely]] {
+                batches.back().push_back(*change);
+            } else {
+                throw utils::invalid_file::contains_invalid_data(filename);
+            }
+        }
+
+        if (batches.back().empty()) {
+            batches.pop_back();
+        }
+        return batches;
+    }
+}
+
+
+/** Insertion of a new vertex, or removal of an existing one by its id. */
+struct vertex_change final {
+    bool insert;
+    vertex v;
+
+    /** Batches of `+ id x1 y1 x2 y2` or `- id` lines. */
+    [[gnu::cold]]
+    static std::vector<std::vector<vertex_change>> read_batches(const std::string& filename) {
+        return utils::read_batches<vertex_change>(filename, [](char op, std::istream& words) {
+            unsigned id = 0;
+            double x1 = 0, y1 = 0, x2 = 0, y2 = 0;
+            if (op == '+' && words >> id >> x1 >> y1 >> x2 >> y2 && id > 0) {
+                return std::optional(vertex_change { true, vertex::with_id(id, x1, y1, x2, y2) });
+            } else if (op == '-' && words >> id) {
+                return std::optional(vertex_change { false, vertex::with_id(id, 0, 0, 0, 0) });
+            }
+            return std::optional<vertex_change>();
+        });
+    }
+};
+
+
+/** Moves one vertex in a cost space, or scales the coordinates of a whole cost space. */
+struct cost_change final {
+    /** Vertex id, or zero to scale every vertex. */
+    unsigned id;
+    uint8_t space;
+    vertex::point p;
+
+    /** Point of vertex `v` in this space after the change. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline vertex::point apply(const vertex& v) const noexcept {
+        if (this->id == 0) {
+            return vertex::point(v[this->space].x() * this->p.x(), v[this->space].y() * this->p.y());
+        }
+        return (v.id() == this->id) ? this->p : v[this->space];
+    }
+
+    /** Batches of `m id space x y` (move) or `s space factor` (scale) lines, with spaces 1 and 2. */
+    [[gnu::cold]]
+    static std::vector<std::vector<cost_change>> read_batches(const std::string& filename) {
+        return utils::read_batches<cost_change>(filename, [](char op, std::istream& words) {
+            unsigned id = 0, space = 0;
+            double x = 0, y = 0, factor = 0;
+            if (op == 'm' && words >> id >> space >> x >> y && id > 0 && (space == 1 || space == 2)) {
+                return std::optional(cost_change { id, (uint8_t) (space - 1), vertex::point(x, y) });
+            } else if (op == 's' && words >> space >> factor && factor > 0 && (space == 1 || space == 2)) {
+                return std::optional(cost_change { 0, (uint8_t) (space - 1), vertex::point(factor, factor) });
+            }
+            return std::optional<cost_change>();
+        });
+    }
+};
+
+
+/**
+ * Keeps a solved `graph` up to date with vertex insertions, removals and cost changes.
+ *
+ * The model is changed in place, keeping the subtour cuts that are still valid, and the previous
+ * tours are repaired into a MIP start for the next solve: removed vertices are skipped, new ones
+ * go where they cost the least, and `similarity_repair` restores the shared edges if needed.
+ */
+struct dynamic_instance final {
+private:
+    graph& g;
+    utils::pair<tour> tours;
+
+    /** Inserts `w` between the pair of consecutive vertices where it costs the least. */
+    [[gnu::hot]]
+    static void insert_cheapest(tour& tour, uint8_t i, std::span<const vertex> vertices, unsigned w) {
+        if (tour.size() < 2) [[unlikely]] {
+            tour.push_back(w);
+            return;
+        }
+        const auto cost = [vertices, i](unsigned u, unsigned v) {
+            return vertices[u][i].cost(vertices[v][i]);
+        };
+
+        double best = INFINITY;
+        size_t after = 0;
+        for (size_t x = 0; x < tour.size(); x++) {
+            const unsigned a = tour[x], b = tour[(x + 1) % tour.size()];
+            const double delta = cost(a, w) + cost(w, b) - cost(a, b);
+            if (delta < best) {
+                best = delta;
+                after = x;
+            }
+        }
+        tour.insert(tour.begin() + after + 1, w);
+    }
+
+public:
+    [[gnu::cold]]
+    explicit dynamic_instance(graph& g): g(g), tours({ g.tour(0), g.tour(1) }) { }
+
+    /** Number of vertices. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline size_t order() const noexcept {
+        return this->g.order();
+    }
+
+    /** Tours used as the start of the next solve, or found by the last one. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline const utils::pair<tour>& current() const noexcept {
+        return this->tours;
+    }
+
+    [[gnu::cold]]
+    void insert(const vertex& v) {
+        const unsigned w = this->g.insert_vertex(v);
+        for (uint8_t i = 0; i <= 1; i++) {
+            insert_cheapest(this->tours[i], i, this->g.vertices, w);
+        }
+    }
+
+    /** Removes the vertex with the given `id`, returning false when there is none. */
+    [[gnu::cold]]
+    bool remove(unsigned id) {
+        const auto& vertices = this->g.vertices;
+        const auto found = std::find_if(vertices.begin(), vertices.end(), [id](const vertex& v) {
+            return v.id() == id;
+        });
+        if (found == vertices.end()) [[unlikely]] {
+            return false;
+        }
+        const unsigned w = (unsigned) (found - vertices.begin());
+        const unsigned last = (unsigned) this->order() - 1;
+
+        this->g.remove_vertex(w);
+        for (auto& tour : this->tours) {
+            std::erase(tour, w);
+            std::replace(tour.begin(), tour.end(), last, w);
+        }
+        return true;
+    }
+
+    /**
+     * Applies cost changes to the current vertices, updating only the affected objective
+     * coefficients. Returns how many were changed; the tours stay valid as a start.
+     */
+    [[gnu::cold]]
+    size_t apply(std::span<const cost_change> changes) {
+        auto next = std::vector<vertex>(this->g.vertices.begin(), this->g.vertices.end());
+        for (const auto& change : changes) {
+            for (auto& v : next) {
+                v = v.with_point(change.space, change.apply(v));
+            }
+        }
+        return this->g.update_costs(next);
+    }
+
+    [[gnu::cold]]
+    void apply(const vertex_change& change) {
+        if (change.insert) {
+            this->insert(change.v);
+        } else if (!this->remove(change.v.id())) [[unlikely]] {
+            throw std::out_of_range("no vertex with id " + std::to_string(change.v.id()));
+        }
+    }
+
+    /** Solves the changed model from the repaired tours, returning the time taken in seconds. */
+    [[gnu::hot]]
+    double reoptimize(termination& control, memory_guard& guard) {
+        const auto start = std::chrono::steady_clock::now();
+
+        if (tour::shared(this->tours[0], this->tours[1], this->order()) < this->g.k) {
+            this->tours = similarity_repair::run(this->g.vertices, this->tours, this->g.k);
+        }
+        this->g.keep_cuts();
+        this->g.set_start(this->tours);
+        this->g.solve(control, guard);
+        this->tours = { this->g.tour(0), this->g.tour(1) };
+
+        const std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+        return secs.count();
+    }
+};
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <chrono>
+#include <cmath>
 #include <concepts>
 #include <functional>
 #include <span>
@@ -10,6 +12,14 @@
 #include <gurobi_c++.h>
 #include "vertex.hpp"
 #include "tour.hpp"
+#include "termination.hpp"
+#include "cuts.hpp"
+#include "memory.hpp"
+#include "repair.hpp"
+#include "exchange.hpp"
+#include "fingerprint.hpp"
+#include "mailbox.hpp"
+#include "trace.hpp"
 
 
 namespace utils {
@@ -43,28 +53,79 @@ struct subtour_elim final : public GRBCallback {
 public:
     const std::span<const vertex> vertices;
     const  utils::pair<utils::matrix<GRBVar>>& vars;
+    termination& control;
+    memory_guard& guard;
+    cut_pool& pool;
+    /** Separate subtours at integer solutions; disabled on compact formulations. */
+    bool separate = true;
+    /** Suggest patched tours for solutions with subtours. */
+    bool patch = true;
+    /** Minimum number of shared edges between tours. */
+    unsigned similarity = 0;
+    /** Objective weight of each tour cost. */
+    utils::pair<double> weights = { 1., 1. };
+    /** Number of patched solutions suggested. */
+    uint64_t patched = 0;
+    /** Incumbents and cuts shared with concurrent processes, if any. */
+    exchange *shared = nullptr;
+    /** Incumbents posted by heuristic threads, if any. */
+    const mailbox *inbox = nullptr;
+    /** Incumbents taken from `inbox`. */
+    uint64_t received = 0;
+    /** Seconds spent separating integer solutions. */
+    double separation_secs = 0.0;
+    /** Integer solutions already separated, if any. */
+    solution_cache *cache = nullptr;
+    /** Cost of each tour of the incumbent, kept up to date when set. */
+    utils::pair<double> *incumbent = nullptr;
+    /** Records every integer solution and node relaxation seen, if set. */
+    trace_writer *trace = nullptr;
+    /** Called with incumbent, bound and explored nodes on every MIP progress check. */
+    std::function<void(double, double, double)> progress;
 
     [[gnu::cold]] [[gnu::nothrow]]
-    inline subtour_elim(std::span<const vertex> vertices, const utils::pair<utils::matrix<GRBVar>>& vars) noexcept:
-        GRBCallback(), vertices(vertices), vars(vars)
+    inline subtour_elim(
+        std::span<const vertex> vertices,
+        const utils::pair<utils::matrix<GRBVar>>& vars,
+        termination& control,
+        memory_guard& guard,
+        cut_pool& pool
+    ) noexcept:
+        GRBCallback(), vertices(vertices), vars(vars), control(control), guard(guard), pool(pool)
     { }
 
 private:
+    /** Version of `inbox` last seen. */
+    uint64_t seen = 0;
+
     [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
     inline size_t count() const noexcept {
         return this->vertices.size();
     }
 
     [[gnu::hot]]
-    inline void lazy_constraint_subtour_elimination(uint8_t i) {
-        auto tour = utils::min_sub_tour(this->vertices, [this, i](unsigned u, unsigned v) {
+    inline utils::matrix<bool> solution(uint8_t i) {
+        return utils::get_solutions(this->count(), [this, i](unsigned u, unsigned v) {
             return this->getSolution(this->vars[i][u][v]) > 0.5;
         });
+    }
 
-        if (tour.size() >= this->count()) [[unlikely]] {
-            return;
+    /** Node relaxation of tour `i`, only valid when the node LP was solved to optimality. */
+    [[gnu::hot]]
+    inline utils::matrix<double> relaxation(uint8_t i) {
+        auto values = utils::matrix<double>(this->count());
+        for (unsigned u = 0; u < this->count(); u++) {
+            values[u][u] = 0.0;
+            for (unsigned v = u + 1; v < this->count(); v++) {
+                values[u][v] = values[v][u] = this->getNodeRel(this->vars[i][u][v]);
+            }
         }
+        return values;
+    }
 
+    /** Adds `E(S) <= |S| - 1` for the subtour `tour` of tour `i`. */
+    [[gnu::hot]]
+    inline void add_subtour_cut(uint8_t i, const tour& tour) {
         auto expr = GRBLinExpr();
         for (unsigned u = 0; u < tour.size(); u++) {
             for (unsigned v = u + 1; v < tour.size(); v++) {
@@ -72,14 +133,261 @@ private:
             }
         }
         this->addLazy(expr, GRB_LESS_EQUAL, tour.size()-1);
+        if (this->pool.add(i, tour) && this->shared != nullptr) {
+            this->shared->publish_cut(i, tour);
+        }
+    }
+
+    /** Adds a cut for the smallest subtour, returning every component of the solution. */
+    [[gnu::hot]]
+    inline std::vector<tour> lazy_constraint_subtour_elimination(uint8_t i, const utils::matrix<bool>& solution) {
+        auto components = tour::sub_tours(this->vertices, solution);
+
+        if (components.size() <= 1) [[unlikely]] {
+            return components;
+        }
+        const auto& tour = *std::min_element(components.begin(), components.end(), [](const auto& a, const auto& b) {
+            return a.size() < b.size();
+        });
+        this->add_subtour_cut(i, tour);
+        return components;
+    }
+
+    /** The smallest component, or nothing for a single tour. */
+    [[gnu::pure]] [[gnu::hot]]
+    static inline tour smallest(const std::vector<tour>& components) {
+        if (components.size() <= 1) {
+            return tour();
+        }
+        return *std::min_element(components.begin(), components.end(), [](const auto& a, const auto& b) {
+            return a.size() < b.size();
+        });
+    }
+
+    /**
+     * Repeats the cuts stored for a solution seen before, returning whether it was found.
+     * Patching and publishing were done the first time, so they are skipped.
+     */
+    [[gnu::hot]]
+    inline bool repeat_cached(const solution_cache::key& key) {
+        const auto cuts = this->cache->find(key);
+        if (!cuts) [[likely]] {
+            return false;
+        }
+        for (uint8_t i = 0; i <= 1; i++) {
+            if (!(*cuts)[i].empty()) {
+                this->add_subtour_cut(i, (*cuts)[i]);
+            }
+        }
+        if (this->shared != nullptr) {
+            this->poll_shared(finite_or_inf(this->getDoubleInfo(GRB_CB_MIPSOL_OBJBST)));
+        }
+        return true;
+    }
+
+    /** Provides both tours as a heuristic solution. */
+    [[gnu::hot]]
+    inline void set_tours(const utils::pair<tour>& tours) {
+        auto vars = std::vector<GRBVar>();
+        auto values = std::vector<double>();
+        vars.reserve(this->count() * (this->count() - 1));
+        values.reserve(this->count() * (this->count() - 1));
+
+        for (uint8_t i = 0; i <= 1; i++) {
+            const auto next = tours[i].successors(this->count());
+            for (unsigned u = 0; u < this->count(); u++) {
+                for (unsigned v = u + 1; v < this->count(); v++) {
+                    vars.push_back(this->vars[i][u][v]);
+                    values.push_back((next[u] == v || next[v] == u) ? 1. : 0.);
+                }
+            }
+        }
+        this->setSolution(vars.data(), values.data(), (int) vars.size());
+    }
+
+    /**
+     * Patches the subtours of a rejected solution into Hamiltonian cycles and suggests them
+     * as a new incumbent, when cheaper than the current one.
+     *
+     * If the patched tours do not share enough edges, they go through `similarity_repair` first.
+     */
+    [[gnu::hot]]
+    inline void suggest_patched(utils::pair<std::vector<tour>> components) {
+        auto tours = utils::pair<tour> {
+            tour::patch(0, this->vertices, std::move(components[0])),
+            tour::patch(1, this->vertices, std::move(components[1])),
+        };
+        if (tours[0].size() != this->count() || tours[1].size() != this->count()) [[unlikely]] {
+            return;
+        }
+
+        if (tour::shared(tours[0], tours[1], this->count()) < this->similarity) {
+            tours = similarity_repair::run(this->vertices, tours, this->similarity);
+        }
+
+        const double cost = this->weights[0] * tours[0].cost(0, this->vertices)
+            + this->weights[1] * tours[1].cost(1, this->vertices);
+        const double best = finite_or_inf(this->getDoubleInfo(GRB_CB_MIPSOL_OBJBST));
+        if (cost < best - 1e-6) {
+            this->set_tours(tours);
+            this->patched++;
+            if (this->shared != nullptr) {
+                this->shared->publish(tours, cost);
+            }
+        }
+    }
+
+    /** Adds the cuts found by other processes and suggests their incumbent, if better. */
+    [[gnu::hot]]
+    inline void poll_shared(double best) {
+        for (const auto& [i, set] : this->shared->cuts()) {
+            auto expr = GRBLinExpr();
+            for (unsigned u = 0; u < set.size(); u++) {
+                for (unsigned v = u + 1; v < set.size(); v++) {
+                    expr += this->vars[i][set[u]][set[v]];
+                }
+            }
+            this->addLazy(expr, GRB_LESS_EQUAL, set.size() - 1);
+            this->pool.add(i, set);
+        }
+        if (auto incumbent = this->shared->incumbent(best - 1e-6)) {
+            this->set_tours(incumbent->first);
+        }
+    }
+
+    [[gnu::const]] [[gnu::hot]] [[gnu::nothrow]]
+    static inline double finite_or_inf(double value) noexcept {
+        return (std::abs(value) < GRB_INFINITY) ? value : std::copysign(INFINITY, value);
+    }
+
+    [[gnu::hot]]
+    inline void check_termination() {
+        const double best = finite_or_inf(this->getDoubleInfo(GRB_CB_MIP_OBJBST));
+        const double bound = finite_or_inf(this->getDoubleInfo(GRB_CB_MIP_OBJBND));
+        const double nodes = this->getDoubleInfo(GRB_CB_MIP_NODCNT);
+        if (this->progress) {
+            this->progress(best, bound, nodes);
+        }
+
+        if (this->control.check(best, bound, nodes)) [[unlikely]] {
+            this->abort();
+        }
+    }
+
+    [[gnu::hot]]
+    inline void check_memory() {
+        switch (this->guard.poll()) {
+            case memory_guard::level::critical:
+                this->control.stop(termination::reason::memory_limit);
+                this->abort();
+                [[fallthrough]];
+            case memory_guard::level::shed:
+                // cuts already given to Gurobi stay until the solve ends, only the pool is trimmed
+                this->pool.shed();
+                break;
+            default:
+                break;
+        }
+    }
+
+    /** Keeps the cost of each tour of `solutions`, a single tour each, if it is the new incumbent. */
+    [[gnu::hot]]
+    inline void record_incumbent(const utils::pair<utils::matrix<bool>>& solutions) {
+        const double best = finite_or_inf(this->getDoubleInfo(GRB_CB_MIPSOL_OBJBST));
+        if (this->getDoubleInfo(GRB_CB_MIPSOL_OBJ) > best + 1e-6) [[likely]] {
+            return;
+        }
+        for (uint8_t i = 0; i <= 1; i++) {
+            double cost = 0.0;
+            for (unsigned u = 0; u < this->count(); u++) {
+                for (unsigned v = u + 1; v < this->count(); v++) {
+                    if (solutions[i][u][v]) {
+                        cost += this->vertices[u][i].cost(this->vertices[v][i]);
+                    }
+                }
+            }
+            (*this->incumbent)[i] = cost;
+        }
+    }
+
+    /** Suggests the incumbent posted on `inbox`, when it changed and is better. */
+    [[gnu::hot]]
+    inline void poll_inbox(double best) {
+        if (auto tours = this->inbox->take(this->seen, best - 1e-6)) [[unlikely]] {
+            this->set_tours(*tours);
+            this->received++;
+        }
+    }
+
+    /** Cuts off subtours of the integer solution, and shares or patches it. */
+    [[gnu::hot]]
+    void separate_solution() {
+        this->pool.next_round();
+        const auto solutions = utils::pair<utils::matrix<bool>> { this->solution(0), this->solution(1) };
+        if (this->trace != nullptr) [[unlikely]] {
+            this->trace->solution(solutions);
+        }
+        const auto key = solution_cache::key(utils::fingerprint(solutions[0]), utils::fingerprint(solutions[1]));
+        if (this->cache != nullptr && this->repeat_cached(key)) {
+            return;
+        }
+        auto components = utils::pair<std::vector<tour>> {
+            this->lazy_constraint_subtour_elimination(0, solutions[0]),
+            this->lazy_constraint_subtour_elimination(1, solutions[1]),
+        };
+        if (this->cache != nullptr) {
+            this->cache->store(key, { smallest(components[0]), smallest(components[1]) });
+        }
+        const bool feasible = (components[0].size() == 1 && components[1].size() == 1);
+        if (feasible && this->incumbent != nullptr) {
+            this->record_incumbent(solutions);
+        }
+        if (this->shared != nullptr) {
+            if (feasible) {
+                const auto tours = utils::pair<tour> { components[0][0], components[1][0] };
+                this->shared->publish(tours, this->getDoubleInfo(GRB_CB_MIPSOL_OBJ));
+            }
+            this->poll_shared(finite_or_inf(this->getDoubleInfo(GRB_CB_MIPSOL_OBJBST)));
+        }
+        if (this->patch && !feasible) {
+            this->suggest_patched(std::move(components));
+        }
     }
 
 protected:
     [[gnu::hot]]
     void callback() {
-        if (this->where == GRB_CB_MIPSOL) [[likely]] {
-            this->lazy_constraint_subtour_elimination(0);
-            this->lazy_constraint_subtour_elimination(1);
+        if (this->where == GRB_CB_MIPSOL && this->separate) [[likely]] {
+            const auto start = std::chrono::steady_clock::now();
+            this->separate_solution();
+            const std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+            this->separation_secs += secs.count();
+
+        } else if (this->where == GRB_CB_MIPSOL && (this->incumbent != nullptr || this->trace != nullptr)) {
+            // compact formulations: every integer solution is a pair of tours
+            const auto solutions = utils::pair<utils::matrix<bool>> { this->solution(0), this->solution(1) };
+            if (this->trace != nullptr) {
+                this->trace->solution(solutions);
+            }
+            if (this->incumbent != nullptr) {
+                this->record_incumbent(solutions);
+            }
+
+        } else if (this->where == GRB_CB_MIPNODE && (this->shared != nullptr || this->inbox != nullptr || this->trace != nullptr)) {
+            if (this->trace != nullptr && this->getIntInfo(GRB_CB_MIPNODE_STATUS) == GRB_OPTIMAL) {
+                this->trace->relaxation({ this->relaxation(0), this->relaxation(1) });
+            }
+            const double best = finite_or_inf(this->getDoubleInfo(GRB_CB_MIPNODE_OBJBST));
+            if (this->shared != nullptr && this->separate) {
+                this->poll_shared(best);
+            }
+            if (this->inbox != nullptr) {
+                this->poll_inbox(best);
+            }
+
+        } else if (this->where == GRB_CB_MIP) {
+            this->check_memory();
+            this->check_termination();
         }
     }
 };
@@ -0,0 +1,445 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include "tour.hpp"
+#include "vertex.hpp"
+
+
+/**
+ * POSIX shared-memory segment where concurrent processes solving the same instance exchange
+ * their best tour pair and the subtour sets they separate.
+ *
+ * The incumbent is guarded by a seqlock, so readers never block writers. Subtour sets go into
+ * a fixed ring where each slot is stamped with the ticket that last wrote it, and readers skip
+ * the slots that were overwritten before they could copy them.
+ *
+ * A process that dies while writing leaves the seqlock or a slot half-written. After `STALE`,
+ * the seqlock is taken over if its writer is gone, dropping the incumbent, and the slot is
+ * skipped. The segment itself is removed by the last process to detach, also when `modelo`
+ * exits on its hard timeout through `release_active`; after a crash it stays until then.
+ */
+struct exchange final {
+private:
+    static constexpr uint64_t MAGIC = 0x6d6f64656c6f3032;
+    /** Time a seqlock or slot may stay mid-write before its writer is considered gone. */
+    static constexpr auto STALE = std::chrono::seconds(1);
+
+    struct header final {
+        std::atomic<uint64_t> magic;
+        uint64_t fingerprint;
+        uint32_t order;
+        std::atomic<uint32_t> attached;
+        /** Seqlock for the incumbent, odd while being written. */
+        std::atomic<uint64_t> seq;
+        /** Process that last took the seqlock. */
+        std::atomic<pid_t> locker;
+        double cost;
+        pid_t writer;
+        /** Number of sets ever appended to the ring. */
+        std::atomic<uint64_t> head;
+    };
+
+    struct slot final {
+        /** `2 t + 2` when ticket `t` was fully written, `2 t + 1` while writing it. */
+        std::atomic<uint64_t> stamp;
+        pid_t writer;
+        uint8_t space;
+        uint32_t size;
+    };
+
+    /** Tells when the same value has been seen for longer than `STALE`. */
+    struct stall final {
+        uint64_t value = UINT64_MAX;
+        std::chrono::steady_clock::time_point since;
+
+        [[gnu::hot]]
+        bool stuck(uint64_t current) noexcept {
+            const auto now = std::chrono::steady_clock::now();
+            if (current != this->value) {
+                this->value = current;
+                this->since = now;
+                return false;
+            }
+            return now - this->since >= STALE;
+        }
+    };
+
+    std::string name;
+    void *base = MAP_FAILED;
+    size_t length = 0;
+    uint64_t last_seq = 0;
+    uint64_t next_ticket = 0;
+    stall odd_seq, open_slot;
+    bool registered = false;
+
+    /** The segment attached by this process, and a copy of its name, for `release_active`. */
+    static inline std::atomic<exchange *> active = nullptr;
+    static inline char active_name[64] = {};
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline header& head() const noexcept {
+        return *static_cast<header *>(this->base);
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline unsigned *tours() const noexcept {
+        return reinterpret_cast<unsigned *>(static_cast<char *>(this->base) + sizeof(header));
+    }
+
+    [[gnu::const]] [[gnu::hot]] [[gnu::nothrow]]
+    static inline size_t slot_size(size_t order) noexcept {
+        const size_t bytes = sizeof(slot) + order * sizeof(unsigned);
+        return (bytes + alignof(slot) - 1) / alignof(slot) * alignof(slot);
+    }
+
+    [[gnu::const]] [[gnu::cold]] [[gnu::nothrow]]
+    static inline size_t ring_offset(size_t order) noexcept {
+        const size_t bytes = sizeof(header) + 2 * order * sizeof(unsigned);
+        return (bytes + alignof(slot) - 1) / alignof(slot) * alignof(slot);
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline slot& at(uint64_t ticket) const noexcept {
+        const size_t idx = ticket % CAPACITY;
+        auto bytes = static_cast<char *>(this->base) + ring_offset(this->order()) + idx * slot_size(this->order());
+        return *reinterpret_cast<slot *>(bytes);
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    static inline unsigned *items(slot& s) noexcept {
+        return reinterpret_cast<unsigned *>(reinterpret_cast<char *>(&s) + sizeof(slot));
+    }
+
+    /** Stops counting this process as attached, removing the name when it was the last. Async-signal-safe. */
+    [[gnu::cold]] [[gnu::nothrow]]
+    static void leave(header& head, const char *name) noexcept {
+        if (head.attached.fetch_sub(1) == 1) {
+            shm_unlink(name);
+        }
+    }
+
+    [[gnu::cold]] [[gnu::nothrow]]
+    void unmap() noexcept {
+        if (this->base != MAP_FAILED) [[likely]] {
+            munmap(this->base, this->length);
+            this->base = MAP_FAILED;
+        }
+    }
+
+    /**
+     * Takes over the seqlock left odd at `seq` once it stayed so for `STALE` and the process
+     * that took it no longer exists. The incumbent may be half-written, so it is dropped.
+     */
+    [[gnu::cold]]
+    void recover(uint64_t seq) {
+        if (!this->odd_seq.stuck(seq)) [[likely]] {
+            return;
+        }
+        auto& head = this->head();
+        const pid_t locker = head.locker.load(std::memory_order_relaxed);
+        if (locker > 0 && (kill(locker, 0) == 0 || errno != ESRCH)) {
+            return;
+        }
+        if (!head.seq.compare_exchange_strong(seq, seq + 2, std::memory_order_acquire)) {
+            return;
+        }
+        head.locker.store(getpid(), std::memory_order_relaxed);
+        head.cost = INFINITY;
+        head.writer = 0;
+        head.seq.store(seq + 3, std::memory_order_release);
+        this->last_seq = seq + 3;
+    }
+
+    [[noreturn]] [[gnu::cold]]
+    static void fail(const char *call) {
+        throw std::system_error(errno, std::generic_category(), call);
+    }
+
+public:
+    /** Subtour sets kept in the ring before being overwritten. */
+    static constexpr size_t CAPACITY = 4096;
+
+    /** Hash of the vertices, in order, and of the similarity bound, identifying the instance. */
+    [[gnu::pure]] [[gnu::cold]]
+    static uint64_t fingerprint(std::span<const vertex> vertices, unsigned k) noexcept {
+        uint64_t hash = 0xcbf29ce484222325 ^ k;
+        const auto mix = [&hash](uint64_t value) {
+            hash = (hash ^ value) * 0x100000001b3;
+        };
+        for (const auto& v : vertices) {
+            mix(v.id());
+            for (uint8_t i = 0; i <= 1; i++) {
+                mix(std::bit_cast<uint64_t>(v[i].x()));
+                mix(std::bit_cast<uint64_t>(v[i].y()));
+            }
+        }
+        return hash;
+    }
+
+    /** Opens the segment for this instance, creating it when no other process did. */
+    [[gnu::cold]]
+    exchange(std::span<const vertex> vertices, unsigned k) {
+        const auto print = fingerprint(vertices, k);
+        const size_t order = vertices.size();
+
+        std::ostringstream name;
+        name << "/modelo-" << std::hex << print;
+        this->name = name.str();
+        this->length = ring_offset(order) + CAPACITY * slot_size(order);
+
+        bool created = true;
+        int fd = shm_open(this->name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd < 0 && errno == EEXIST) {
+            created = false;
+            fd = shm_open(this->name.c_str(), O_RDWR, 0600);
+        }
+        if (fd < 0) [[unlikely]] {
+            fail("shm_open");
+        }
+
+        if (created) {
+            if (ftruncate(fd, (off_t) this->length) != 0) [[unlikely]] {
+                close(fd);
+                fail("ftruncate");
+            }
+        } else {
+            // the creator may still be sizing the segment
+            struct stat info = {};
+            for (unsigned tries = 0; fstat(fd, &info) == 0 && (size_t) info.st_size < this->length; tries++) {
+                if (tries > 1000) [[unlikely]] {
+                    close(fd);
+                    errno = ETIMEDOUT;
+                    fail("fstat");
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+
+        this->base = mmap(nullptr, this->length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (this->base == MAP_FAILED) [[unlikely]] {
+            fail("mmap");
+        }
+
+        auto& head = this->head();
+        if (created) {
+            head.fingerprint = print;
+            head.order = (uint32_t) order;
+            head.cost = INFINITY;
+            head.writer = 0;
+            head.locker = 0;
+            head.magic.store(MAGIC, std::memory_order_release);
+        } else {
+            // the creator may still be filling the header, or it may be from another version
+            for (unsigned tries = 0; head.magic.load(std::memory_order_acquire) != MAGIC; tries++) {
+                if (tries > 1000) [[unlikely]] {
+                    this->unmap();
+                    errno = EPROTO;
+                    fail("exchange");
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            if (head.fingerprint != print || head.order != order) [[unlikely]] {
+                this->unmap();
+                errno = EINVAL;
+                fail("exchange");
+            }
+        }
+        head.attached.fetch_add(1);
+
+        // the name is copied first, so a handler never sees the pointer without it
+        if (active.load() == nullptr && this->name.size() < sizeof(active_name)) [[likely]] {
+            this->name.copy(active_name, this->name.size());
+            active_name[this->name.size()] = '\0';
+            exchange *none = nullptr;
+            this->registered = active.compare_exchange_strong(none, this);
+        }
+    }
+
+    exchange(const exchange&) = delete;
+    exchange& operator=(const exchange&) = delete;
+
+    /** Detaches from the segment, removing it when no other process is attached. */
+    [[gnu::cold]]
+    ~exchange() {
+        exchange *self = this;
+        // unless `release_active` already left it
+        if (this->base != MAP_FAILED && (!this->registered || active.compare_exchange_strong(self, nullptr))) {
+            leave(this->head(), this->name.c_str());
+        }
+        this->unmap();
+    }
+
+    /**
+     * Leaves the segment of this process before exiting without unwinding, from a signal
+     * handler. The mapping stays, since other threads may still be reading it until `_exit`.
+     */
+    [[gnu::cold]] [[gnu::nothrow]]
+    static void release_active() noexcept {
+        if (auto segment = active.exchange(nullptr)) {
+            leave(segment->head(), active_name);
+        }
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline size_t order() const noexcept {
+        return this->head().order;
+    }
+
+    /** Incumbents and sets published by this process, and received from others. */
+    uint64_t published = 0, received = 0;
+    uint64_t cuts_published = 0, cuts_received = 0;
+
+    /**
+     * Publishes a tour pair with objective `cost` if it is better than the shared one. Gives up
+     * instead of waiting when another process is writing.
+     */
+    [[gnu::hot]]
+    bool publish(const utils::pair<tour>& tours, double cost) {
+        auto& head = this->head();
+        uint64_t seq = head.seq.load(std::memory_order_relaxed);
+        if (seq & 1) [[unlikely]] {
+            this->recover(seq);
+            return false;
+        }
+        if (cost >= head.cost) {
+            return false;
+        }
+        if (!head.seq.compare_exchange_strong(seq, seq + 1, std::memory_order_acquire)) {
+            return false;
+        }
+        head.locker.store(getpid(), std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        if (cost < head.cost) [[likely]] {
+            head.cost = cost;
+            head.writer = getpid();
+            for (uint8_t i = 0; i <= 1; i++) {
+                std::memcpy(this->tours() + i * this->order(), tours[i].data(), this->order() * sizeof(unsigned));
+            }
+            this->published++;
+        }
+        head.seq.store(seq + 2, std::memory_order_release);
+        this->last_seq = seq + 2;
+        return true;
+    }
+
+    /** Tour pair published by another process since the last call, if cheaper than `best`. */
+    [[gnu::hot]]
+    std::optional<std::pair<utils::pair<tour>, double>> incumbent(double best) {
+        auto& head = this->head();
+        const uint64_t before = head.seq.load(std::memory_order_acquire);
+        if (before == this->last_seq) [[likely]] {
+            return std::nullopt;
+        }
+        if (before & 1) [[unlikely]] {
+            this->recover(before);
+            return std::nullopt;
+        }
+
+        auto tours = utils::pair<tour>();
+        for (uint8_t i = 0; i <= 1; i++) {
+            tours[i].resize(this->order());
+            std::memcpy(tours[i].data(), this->tours() + i * this->order(), this->order() * sizeof(unsigned));
+        }
+        const double cost = head.cost;
+        const pid_t writer = head.writer;
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (head.seq.load(std::memory_order_relaxed) != before) [[unlikely]] {
+            return std::nullopt;
+        }
+        this->last_seq = before;
+        if (writer == getpid() || cost >= best) {
+            return std::nullopt;
+        }
+        for (const auto& tour : tours) {
+            if (std::any_of(tour.begin(), tour.end(), [this](unsigned v) { return v >= this->order(); })) [[unlikely]] {
+                return std::nullopt;
+            }
+        }
+        this->received++;
+        return std::pair(std::move(tours), cost);
+    }
+
+    /** Appends a subtour set for tour `i` to the ring. */
+    [[gnu::hot]]
+    void publish_cut(uint8_t i, const tour& set) {
+        if (set.size() >= this->order()) [[unlikely]] {
+            return;
+        }
+        const uint64_t ticket = this->head().head.fetch_add(1);
+        auto& s = this->at(ticket);
+
+        s.stamp.store(2 * ticket + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        s.writer = getpid();
+        s.space = i;
+        s.size = (uint32_t) set.size();
+        std::memcpy(items(s), set.data(), set.size() * sizeof(unsigned));
+        s.stamp.store(2 * ticket + 2, std::memory_order_release);
+        this->cuts_published++;
+    }
+
+    /** Subtour sets appended by other processes since the last call, with their tour. */
+    [[gnu::hot]]
+    std::vector<std::pair<uint8_t, tour>> cuts() {
+        auto found = std::vector<std::pair<uint8_t, tour>>();
+        const uint64_t end = this->head().head.load(std::memory_order_acquire);
+        if (end > CAPACITY && this->next_ticket < end - CAPACITY) [[unlikely]] {
+            this->next_ticket = end - CAPACITY;
+        }
+
+        for (; this->next_ticket < end; this->next_ticket++) {
+            const uint64_t ticket = this->next_ticket;
+            auto& s = this->at(ticket);
+            const uint64_t stamp = s.stamp.load(std::memory_order_acquire);
+            if (stamp == 2 * ticket + 1 || stamp < 2 * ticket + 1) {
+                // still being written, try again on the next call unless its writer is gone
+                if (!this->open_slot.stuck(ticket)) [[likely]] {
+                    break;
+                }
+                continue;
+            }
+            if (stamp != 2 * ticket + 2) [[unlikely]] {
+                continue;
+            }
+
+            const pid_t writer = s.writer;
+            const uint8_t space = s.space;
+            const uint32_t size = std::min<uint32_t>(s.size, (uint32_t) this->order());
+            auto set = tour();
+            set.resize(size);
+            std::memcpy(set.data(), items(s), size * sizeof(unsigned));
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s.stamp.load(std::memory_order_relaxed) != stamp || writer == getpid() || space > 1) {
+                continue;
+            }
+            found.emplace_back(space, std::move(set));
+        }
+        this->cuts_received += found.size();
+        return found;
+    }
+};
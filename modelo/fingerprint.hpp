@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "tour.hpp"
+#include "vertex.hpp"
+
+
+namespace utils {
+    /** SplitMix64 finalizer, spreading nearby edge indices over the whole word. */
+    [[gnu::const]] [[gnu::hot]] [[gnu::nothrow]]
+    static constexpr inline uint64_t mix64(uint64_t value) noexcept {
+        value += 0x9e3779b97f4a7c15;
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111eb;
+        return value ^ (value >> 31);
+    }
+
+    /** Hash of the edge set of a solution, independent of the order the edges are visited. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    static inline uint64_t fingerprint(const matrix<bool>& solution) noexcept {
+        const uint64_t n = solution.size();
+        uint64_t hash = 0;
+        for (uint64_t u = 0; u < n; u++) {
+            for (uint64_t v = u + 1; v < n; v++) {
+                if (solution[u][v]) {
+                    hash += mix64(u * n + v);
+                }
+            }
+        }
+        return hash;
+    }
+}
+
+
+/**
+ * Recently seen integer solutions, by the fingerprints of both tours, with the subtour set cut
+ * from each one (empty when it was a single tour).
+ *
+ * Bounded to `CAPACITY` entries, dropping the oldest first. Guarded by a mutex, so it can be
+ * shared by callbacks running on different threads.
+ */
+struct solution_cache final {
+public:
+    using key = std::pair<uint64_t, uint64_t>;
+    using cuts = utils::pair<tour>;
+
+    static constexpr size_t CAPACITY = 4096;
+
+private:
+    struct key_hash final {
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline size_t operator()(const key& k) const noexcept {
+            return utils::mix64(k.first ^ utils::mix64(k.second));
+        }
+    };
+
+    mutable std::mutex lock;
+    std::unordered_map<key, cuts, key_hash> items;
+    std::deque<key> age;
+    uint64_t lookups = 0;
+    uint64_t found = 0;
+
+public:
+    /** Cuts stored for `k`, counting the lookup. */
+    [[gnu::hot]]
+    std::optional<cuts> find(const key& k) {
+        auto guard = std::lock_guard(this->lock);
+        this->lookups++;
+        if (auto it = this->items.find(k); it != this->items.end()) {
+            this->found++;
+            return it->second;
+        }
+        return std::nullopt;
+    }
+
+    [[gnu::hot]]
+    void store(const key& k, cuts sets) {
+        auto guard = std::lock_guard(this->lock);
+        if (!this->items.insert_or_assign(k, std::move(sets)).second) {
+            return;
+        }
+        this->age.push_back(k);
+        if (this->age.size() > CAPACITY) {
+            this->items.erase(this->age.front());
+            this->age.pop_front();
+        }
+    }
+
+    /** Drops every entry, keeping the counters. */
+    [[gnu::cold]]
+    void clear() {
+        auto guard = std::lock_guard(this->lock);
+        this->items.clear();
+        this->age.clear();
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    uint64_t queries() const {
+        auto guard = std::lock_guard(this->lock);
+        return this->lookups;
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    uint64_t hits() const {
+        auto guard = std::lock_guard(this->lock);
+        return this->found;
+    }
+
+    /** Fraction of lookups that found a repeated solution. */
+    [[gnu::pure]] [[gnu::cold]]
+    double hit_rate() const {
+        auto guard = std::lock_guard(this->lock);
+        return (this->lookups > 0) ? (double) this->found / this->lookups : 0.0;
+    }
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "vertex.hpp"
+
+
+namespace utils {
+    /**
+     * `n` vertices with integer coordinates drawn uniformly in both cost spaces, on a square
+     * scaled so that the density matches the default instance (250 vertices on 100 x 100).
+     * The same `n` and `seed` always give the same vertices.
+     */
+    [[gnu::cold]]
+    static std::vector<vertex> random_vertices(unsigned n, uint64_t seed) {
+        constexpr double DEFAULT_SIDE = 100.0, DEFAULT_COUNT = 250.0;
+        const auto side = (int64_t) std::ceil(DEFAULT_SIDE * std::sqrt(std::max(n, 1U) / DEFAULT_COUNT));
+
+        auto random = std::mt19937_64(seed);
+        auto coordinate = std::uniform_int_distribution<int64_t>(0, side - 1);
+        auto vertices = std::vector<vertex>();
+        vertices.reserve(n);
+        for (unsigned id = 1; id <= n; id++) {
+            const double x1 = (double) coordinate(random), y1 = (double) coordinate(random);
+            const double x2 = (double) coordinate(random), y2 = (double) coordinate(random);
+            vertices.push_back(vertex::with_id(id, x1, y1, x2, y2));
+        }
+        return vertices;
+    }
+}
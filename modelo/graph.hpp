@@ -1,10 +1,16 @@
 #pragma once
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <functional>
 #include <iostream>
+#include <map>
 #include <optional>
 #include <span>
 #include <stdexcept>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include <gurobi_c++.h>
@@ -53,9 +59,69 @@ namespace utils {
 }
 
 
+/** How subtours are eliminated for each tour. */
+enum class formulation : uint8_t {
+    /** Subtour elimination constraints added lazily, from the callback. */
+    lazy,
+    /** Single-commodity flow from the first vertex. */
+    flow,
+    /** Miller-Tucker-Zemlin ordering over an orientation of the tour. */
+    mtz,
+};
+
+[[gnu::cold]]
+static inline formulation parse_formulation(const std::string& name) {
+    if (name == "lazy") {
+        return formulation::lazy;
+    } else if (name == "flow") {
+        return formulation::flow;
+    } else if (name == "mtz") {
+        return formulation::mtz;
+    }
+    throw std::invalid_argument("unknown formulation '" + name + "', expected 'lazy', 'flow' or 'mtz'");
+}
+
+[[gnu::cold]]
+static inline std::ostream& operator<<(std::ostream& os, formulation form) {
+    switch (form) {
+        case formulation::lazy:
+            return os << "lazy";
+        case formulation::flow:
+            return os << "flow";
+        case formulation::mtz:
+            return os << "mtz";
+    }
+    return os << "unknown";
+}
+
+
+/** Stop reason for a Gurobi optimization status. */
+[[gnu::const]] [[gnu::cold]]
+static inline termination::reason solver_status(int status) noexcept {
+    switch (status) {
+        case GRB_OPTIMAL:
+            return termination::reason::optimal;
+        case GRB_INFEASIBLE:
+        case GRB_INF_OR_UNBD:
+            return termination::reason::infeasible;
+        default:
+            return termination::reason::solver_limit;
+    }
+}
+
+
 struct graph final {
 private:
     GRBModel model;
+    utils::pair<std::optional<GRBConstr>> cost_limits;
+    /** Lazy rows by subtour set, and whether `keep_cuts` added them from the pool. */
+    std::map<cut_pool::key, std::pair<GRBConstr, bool>> kept;
+    utils::pair<std::vector<GRBConstr>> degree;
+    std::optional<GRBQConstr> similar;
+    /** Linear row from `require_shared`, when one tour is fixed. */
+    std::optional<GRBConstr> overlap;
+    /** Vertices owned by the graph, after the first change to the instance. */
+    std::vector<vertex> owned;
 
     [[gnu::cold]]
     inline GRBVar add_edge(uint8_t i, const vertex& u, const vertex& v) {
@@ -89,7 +155,7 @@ private:
                     expr += this->vars[i][u][v];
                 }
             }
-            this->model.addConstr(expr, GRB_EQUAL, 2.);
+            this->degree[i].push_back(this->model.addConstr(expr, GRB_EQUAL, 2.));
         }
     }
 
@@ -101,24 +167,156 @@ private:
                 expr += this->vars[0][u][v] * this->vars[1][u][v];
             }
         }
-        this->model.addQConstr(expr, GRB_GREATER_EQUAL, k);
+        this->similar = this->model.addQConstr(expr, GRB_GREATER_EQUAL, k);
+    }
+
+    /** Quadratic terms cannot be changed in place, so the similarity constraint is rebuilt. */
+    [[gnu::cold]]
+    inline void rebuild_similarity() {
+        if (this->similar) {
+            this->model.remove(*this->similar);
+            this->similar.reset();
+        }
+        if (this->k > 0) {
+            this->add_constraint_similarity(this->k);
+        }
+    }
+
+    [[gnu::cold]]
+    inline void own_vertices() {
+        if (this->owned.empty()) [[unlikely]] {
+            this->owned.assign(this->vertices.begin(), this->vertices.end());
+        }
+    }
+
+    [[gnu::cold]]
+    inline void check_incremental() const {
+        if (this->form != formulation::lazy) [[unlikely]] {
+            throw std::invalid_argument("incremental changes need the 'lazy' formulation");
+        }
+    }
+
+    /**
+     * Vertex 0 sends one unit of flow to every other vertex, only through edges in the tour.
+     *
+     * Flow variables are continuous, so the model grows by `2 m` columns and `n + m` rows per tour.
+     */
+    [[gnu::cold]]
+    inline void add_constraint_flow(uint8_t i) {
+        const double supply = this->order() - 1;
+        auto flow = utils::matrix<GRBVar>(this->order());
+
+        for (unsigned u = 0; u < this->order(); u++) {
+            for (unsigned v = 0; v < this->order(); v++) {
+                if (u != v) [[likely]] {
+                    const double ub = (v == 0) ? 0. : supply;
+                    flow[u][v] = this->model.addVar(0., ub, 0., GRB_CONTINUOUS);
+                }
+            }
+        }
+
+        for (unsigned v = 0; v < this->order(); v++) {
+            auto balance = GRBLinExpr();
+            for (unsigned u = 0; u < this->order(); u++) {
+                if (u != v) [[likely]] {
+                    balance += flow[u][v];
+                    balance -= flow[v][u];
+                }
+            }
+            this->model.addConstr(balance, GRB_EQUAL, (v == 0) ? -supply : 1.);
+        }
+
+        for (unsigned u = 0; u < this->order(); u++) {
+            for (unsigned v = u + 1; v < this->order(); v++) {
+                this->model.addConstr(flow[u][v] + flow[v][u] <= supply * this->vars[i][u][v]);
+            }
+        }
+    }
+
+    /**
+     * Each edge of the tour is given a direction, with one arc entering and one leaving each
+     * vertex, and vertices other than 0 are ordered along the arcs.
+     */
+    [[gnu::cold]]
+    inline void add_constraint_mtz(uint8_t i) {
+        const double n = this->order();
+        auto arcs = utils::matrix<GRBVar>(this->order());
+        auto order = std::vector<GRBVar>(this->order());
+
+        for (unsigned u = 0; u < this->order(); u++) {
+            order[u] = this->model.addVar((u == 0) ? 0. : 1., (u == 0) ? 0. : n - 1, 0., GRB_CONTINUOUS);
+            for (unsigned v = 0; v < this->order(); v++) {
+                if (u != v) [[likely]] {
+                    arcs[u][v] = this->model.addVar(0., 1., 0., GRB_BINARY);
+                }
+            }
+        }
+
+        for (unsigned u = 0; u < this->order(); u++) {
+            auto in = GRBLinExpr(), out = GRBLinExpr();
+            for (unsigned v = 0; v < this->order(); v++) {
+                if (u != v) [[likely]] {
+                    in += arcs[v][u];
+                    out += arcs[u][v];
+                }
+            }
+            this->model.addConstr(in, GRB_EQUAL, 1.);
+            this->model.addConstr(out, GRB_EQUAL, 1.);
+        }
+
+        for (unsigned u = 0; u < this->order(); u++) {
+            for (unsigned v = u + 1; v < this->order(); v++) {
+                this->model.addConstr(arcs[u][v] + arcs[v][u] == this->vars[i][u][v]);
+            }
+        }
+
+        for (unsigned u = 1; u < this->order(); u++) {
+            for (unsigned v = 1; v < this->order(); v++) {
+                if (u != v) [[likely]] {
+                    this->model.addConstr(order[u] - order[v] + (n - 1) * arcs[u][v] <= n - 2);
+                }
+            }
+        }
+    }
+
+    [[gnu::cold]]
+    inline void add_constraint_subtour(uint8_t i) {
+        switch (this->form) {
+            case formulation::flow:
+                this->add_constraint_flow(i);
+                break;
+            case formulation::mtz:
+                this->add_constraint_mtz(i);
+                break;
+            case formulation::lazy:
+                break;
+        }
     }
 
 public:
     [[gnu::cold]]
-    graph(std::span<const vertex> vertices, const GRBEnv& env, unsigned k = 0):
-        model(env), vertices(vertices), vars({ this->add_vars(0), this->add_vars(1) })
+    graph(std::span<const vertex> vertices, const GRBEnv& env, unsigned k = 0, formulation form = formulation::lazy):
+        model(env), vertices(vertices), vars({ this->add_vars(0), this->add_vars(1) }), form(form), k(k)
     {
         this->add_constraint_deg_2(0);
         this->add_constraint_deg_2(1);
         if (k > 0) {
             this->add_constraint_similarity(k);
         }
+        if (this->form != formulation::lazy) {
+            this->add_constraint_subtour(0);
+            this->add_constraint_subtour(1);
+            this->model.set(GRB_IntParam_LazyConstraints, 0);
+        }
         this->model.update();
     }
 
-    const std::span<const vertex> vertices;
-    const  utils::pair<utils::matrix<GRBVar>> vars;
+    /** Current vertices, changed only through `insert_vertex`, `remove_vertex` and `update_costs`. */
+    std::span<const vertex> vertices;
+    utils::pair<utils::matrix<GRBVar>> vars;
+    const formulation form;
+    /** Minimum number of shared edges. */
+    const unsigned k;
 
     /** Number of vertices. */
     [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
@@ -148,13 +346,415 @@ public:
         return this->model.get(GRB_IntAttr_SolCount);
     }
 
+    /** Subtour sets separated during the search. */
+    cut_pool cuts;
+    /** Integer solutions seen by the callback, kept across solves of the same model. */
+    solution_cache fingerprints;
+    /** Suggest patched tours from solutions rejected by the callback. */
+    bool patching = true;
+    /** Number of patched tours suggested as incumbents. */
+    uint64_t patched = 0;
+
+    /** Segment shared with concurrent processes on the same instance, if any. */
+    exchange *shared = nullptr;
+    /** Incumbents posted by heuristic threads, if any. */
+    const mailbox *inbox = nullptr;
+    /** Number of incumbents taken from `inbox`. */
+    uint64_t received = 0;
+    /** Seconds spent by the callback separating integer solutions. */
+    double separation = 0.0;
+    /** Called with incumbent, bound and explored nodes during `solve()`, if set. */
+    std::function<void(double, double, double)> progress;
+    /** Cost of each tour of the incumbent found during `solve()`, for reports while it runs. */
+    utils::pair<double> incumbent = { INFINITY, INFINITY };
+    /** Records the points seen by the callback during `solve()`, if set. */
+    trace_writer *trace = nullptr;
+
+    /** Weight of each cost space in the objective. */
+    utils::pair<double> weights = { 1., 1. };
+
+    /** Changes the objective to a weighted sum of both tour costs, keeping the rest of the model. */
+    [[gnu::cold]]
+    void set_weights(utils::pair<double> weights) {
+        this->weights = weights;
+        for (uint8_t i = 0; i <= 1; i++) {
+            for (unsigned u = 0; u < this->order(); u++) {
+                for (unsigned v = u + 1; v < this->order(); v++) {
+                    const double cost = this->vertices[u][i].cost(this->vertices[v][i]);
+                    auto var = this->vars[i][u][v];
+                    var.set(GRB_DoubleAttr_Obj, weights[i] * cost);
+                }
+            }
+        }
+    }
+
+    /** Uses both tours as the MIP start of the next `solve()`. */
+    [[gnu::cold]]
+    void set_start(const utils::pair<::tour>& tours) {
+        for (uint8_t i = 0; i <= 1; i++) {
+            const auto next = tours[i].successors(this->order());
+            for (unsigned u = 0; u < this->order(); u++) {
+                for (unsigned v = u + 1; v < this->order(); v++) {
+                    const bool edge = (next[u] == v || next[v] == u);
+                    auto var = this->vars[i][u][v];
+                    var.set(GRB_DoubleAttr_Start, edge ? 1. : 0.);
+                }
+            }
+        }
+    }
+
+    /** Limits the cost of tour `i`, or removes the limit when empty. */
+    [[gnu::cold]]
+    void limit_cost(uint8_t i, std::optional<double> limit) {
+        const double rhs = limit.value_or(GRB_INFINITY);
+        if (auto& constr = this->cost_limits[i]) {
+            constr->set(GRB_DoubleAttr_RHS, rhs);
+            return;
+        }
+
+        auto expr = GRBLinExpr();
+        for (unsigned u = 0; u < this->order(); u++) {
+            for (unsigned v = u + 1; v < this->order(); v++) {
+                expr += this->vertices[u][i].cost(this->vertices[v][i]) * this->vars[i][u][v];
+            }
+        }
+        this->cost_limits[i] = this->model.addConstr(expr, GRB_LESS_EQUAL, rhs);
+    }
+
+    /** Adds `E(S) <= |S| - 1` for the subtour set `key` at the given lazy level, unless kept already. */
+    [[gnu::cold]]
+    bool add_lazy_cut(const cut_pool::key& key, int level, bool pooled) {
+        if (this->kept.contains(key)) [[likely]] {
+            return false;
+        }
+        const auto& [i, set] = key;
+
+        auto expr = GRBLinExpr();
+        for (unsigned u = 0; u < set.size(); u++) {
+            for (unsigned v = u + 1; v < set.size(); v++) {
+                expr += this->vars[i][set[u]][set[v]];
+            }
+        }
+        auto constr = this->model.addConstr(expr, GRB_LESS_EQUAL, set.size() - 1);
+        constr.set(GRB_IntAttr_Lazy, level);
+        this->kept.emplace(key, std::pair(constr, pooled));
+        return true;
+    }
+
+    /**
+     * Adds the sets in the cut pool as lazy model constraints.
+     *
+     * Constraints added from the callback are lost when the model changes, but subtour elimination
+     * does not depend on costs, so they stay valid for later solves. Returns how many were added.
+     */
+    [[gnu::cold]]
+    size_t keep_cuts() {
+        size_t added = 0;
+        for (const auto& [key, _] : this->cuts) {
+            added += this->add_lazy_cut(key, 1, true);
+        }
+        return added;
+    }
+
+    /**
+     * Removes the lazy model constraints added by `keep_cuts` whose set is no longer in the cut
+     * pool, as after `cut_pool::shed`. Rows from `seed_cuts` never enter the pool, so they stay.
+     * Gurobi only allows it between solves. A removed set that is violated again is separated
+     * by the callback. Returns how many were removed.
+     */
+    [[gnu::cold]]
+    size_t shed_cuts() {
+        const auto before = this->kept.size();
+        for (auto it = this->kept.begin(); it != this->kept.end();) {
+            const auto& [constr, pooled] = it->second;
+            if (!pooled || this->cuts.contains(it->first)) {
+                ++it;
+            } else {
+                this->model.remove(constr);
+                it = this->kept.erase(it);
+            }
+        }
+        return before - this->kept.size();
+    }
+
+    /**
+     * Adds subtour sets known before the solve as lazy model constraints, each with its `Lazy`
+     * level: 1 only checks integer solutions, 2 also cuts off fractional nodes, and 3 pulls the
+     * row into the root LP when violated. Returns how many were new.
+     */
+    [[gnu::cold]]
+    size_t seed_cuts(std::span<const std::pair<cut_pool::key, int>> seeds) {
+        size_t added = 0;
+        for (const auto& [key, level] : seeds) {
+            added += this->add_lazy_cut(key, level, false);
+        }
+        return added;
+    }
+
+    /**
+     * Adds vertex `w` to the model: one column per new edge, appended to the degree rows of the
+     * existing vertices, and a new degree row for `w`. Subtour cuts stay valid, since every set
+     * is still a proper subset of the vertices.
+     *
+     * Only for the lazy formulation. Returns the position of the new vertex.
+     */
+    [[gnu::cold]]
+    unsigned insert_vertex(const vertex& w) {
+        this->check_incremental();
+        this->own_vertices();
+        this->owned.push_back(w);
+        this->vertices = this->owned;
+
+        const unsigned n = (unsigned) this->order(), last = n - 1;
+        for (uint8_t i = 0; i <= 1; i++) {
+            auto vars = utils::matrix<GRBVar>(n);
+            for (unsigned u = 0; u < last; u++) {
+                for (unsigned v = 0; v < last; v++) {
+                    vars[u][v] = this->vars[i][u][v];
+                }
+            }
+
+            auto expr = GRBLinExpr();
+            for (unsigned u = 0; u < last; u++) {
+                auto var = this->add_edge(i, this->vertices[u], w);
+                const double cost = this->vertices[u][i].cost(w[i]);
+                var.set(GRB_DoubleAttr_Obj, this->weights[i] * cost);
+                vars[u][last] = var;
+                vars[last][u] = var;
+
+                this->model.chgCoeff(this->degree[i][u], var, 1.);
+                if (auto& constr = this->cost_limits[i]) {
+                    this->model.chgCoeff(*constr, var, cost);
+                }
+                expr += var;
+            }
+            this->degree[i].push_back(this->model.addConstr(expr, GRB_EQUAL, 2.));
+            this->vars[i] = std::move(vars);
+        }
+
+        this->rebuild_similarity();
+        this->model.update();
+        return last;
+    }
+
+    /**
+     * Removes the vertex at position `w` with its columns and degree rows, moving the last vertex
+     * to that position. Subtour cuts over `w` are dropped, the others are renumbered.
+     *
+     * Only for the lazy formulation.
+     */
+    [[gnu::cold]]
+    void remove_vertex(unsigned w) {
+        this->check_incremental();
+        if (w >= this->order()) [[unlikely]] {
+            throw std::out_of_range("no vertex at position " + std::to_string(w));
+        }
+        if (this->order() <= 3) [[unlikely]] {
+            throw std::invalid_argument("a tour needs at least 3 vertices");
+        }
+        this->own_vertices();
+        // cached cuts use the old numbering
+        this->fingerprints.clear();
+
+        const unsigned n = (unsigned) this->order(), last = n - 1;
+        const auto position = [w, last](unsigned u) {
+            return (u == last) ? w : u;
+        };
+
+        for (uint8_t i = 0; i <= 1; i++) {
+            for (unsigned u = 0; u < n; u++) {
+                if (u != w) [[likely]] {
+                    this->model.remove(this->vars[i][u][w]);
+                }
+            }
+            this->model.remove(this->degree[i][w]);
+
+            auto vars = utils::matrix<GRBVar>(last);
+            for (unsigned u = 0; u < n; u++) {
+                for (unsigned v = 0; v < n; v++) {
+                    if (u != w && v != w && u != v) [[likely]] {
+                        vars[position(u)][position(v)] = this->vars[i][u][v];
+                    }
+                }
+            }
+            this->vars[i] = std::move(vars);
+            this->degree[i][w] = this->degree[i][last];
+            this->degree[i].pop_back();
+        }
+
+        auto kept = std::map<cut_pool::key, std::pair<GRBConstr, bool>>();
+        for (auto& [key, row] : this->kept) {
+            auto set = key.second;
+            if (std::binary_search(set.begin(), set.end(), w) || set.size() + 1 >= n) {
+                this->model.remove(row.first);
+                continue;
+            }
+            std::transform(set.begin(), set.end(), set.begin(), position);
+            std::sort(set.begin(), set.end());
+            kept.emplace(cut_pool::key(key.first, std::move(set)), row);
+        }
+        this->kept = std::move(kept);
+        this->cuts.remove_vertex(w, n);
+
+        this->owned[w] = this->owned[last];
+        this->owned.pop_back();
+        this->vertices = this->owned;
+
+        this->rebuild_similarity();
+        this->model.update();
+    }
+
+    /**
+     * Replaces the vertices by `next`, with the same number of vertices in the same positions, and
+     * updates the objective coefficients (and cost limits) of the edges with a moved endpoint.
+     *
+     * Constraints do not depend on costs, so subtour cuts are kept as they are. Returns the number
+     * of coefficients changed.
+     */
+    [[gnu::cold]]
+    size_t update_costs(std::span<const vertex> next) {
+        if (next.size() != this->order()) [[unlikely]] {
+            throw std::invalid_argument("cost updates must keep the same vertices");
+        }
+        auto moved = std::vector<utils::pair<bool>>(this->order());
+        for (unsigned u = 0; u < this->order(); u++) {
+            for (uint8_t i = 0; i <= 1; i++) {
+                const auto &before = this->vertices[u][i], &after = next[u][i];
+                moved[u][i] = (before.x() != after.x() || before.y() != after.y());
+            }
+        }
+        this->owned.assign(next.begin(), next.end());
+        this->vertices = this->owned;
+
+        size_t changed = 0;
+        for (uint8_t i = 0; i <= 1; i++) {
+            for (unsigned u = 0; u < this->order(); u++) {
+                for (unsigned v = u + 1; v < this->order(); v++) {
+                    if (!moved[u][i] && !moved[v][i]) [[likely]] {
+                        continue;
+                    }
+                    const double cost = this->vertices[u][i].cost(this->vertices[v][i]);
+                    auto var = this->vars[i][u][v];
+                    var.set(GRB_DoubleAttr_Obj, this->weights[i] * cost);
+                    if (auto& constr = this->cost_limits[i]) {
+                        this->model.chgCoeff(*constr, var, cost);
+                    }
+                    changed++;
+                }
+            }
+        }
+        this->model.update();
+        return changed;
+    }
+
+    /** Fixes edge `(u, v)` of tour `i` in the solution, until `release_edges`. */
+    [[gnu::cold]]
+    void fix_edge(uint8_t i, unsigned u, unsigned v) {
+        auto var = this->vars[i][u][v];
+        var.set(GRB_DoubleAttr_LB, 1.);
+    }
+
+    /** Undoes every `fix_edge`. */
+    [[gnu::cold]]
+    void release_edges() {
+        for (uint8_t i = 0; i <= 1; i++) {
+            for (unsigned u = 0; u < this->order(); u++) {
+                for (unsigned v = u + 1; v < this->order(); v++) {
+                    auto var = this->vars[i][u][v];
+                    var.set(GRB_DoubleAttr_LB, 0.);
+                }
+            }
+        }
+    }
+
+    /**
+     * Objective of tour `i` with `bonus` subtracted from the cost of each edge of `other`, as a
+     * Lagrangian price on the number of shared edges. A zero bonus restores the weighted costs.
+     */
+    [[gnu::cold]]
+    void price_edges(uint8_t i, const ::tour& other, double bonus) {
+        const auto next = other.successors(this->order());
+        for (unsigned u = 0; u < this->order(); u++) {
+            for (unsigned v = u + 1; v < this->order(); v++) {
+                const bool edge = (next[u] == v || next[v] == u);
+                const double cost = this->weights[i] * this->vertices[u][i].cost(this->vertices[v][i]);
+                auto var = this->vars[i][u][v];
+                var.set(GRB_DoubleAttr_Obj, edge ? cost - bonus : cost);
+            }
+        }
+    }
+
+    /**
+     * Requires tour `i` to use at least `k` edges of `other`, or removes the requirement when
+     * empty. Linear, unlike the similarity constraint, since `other` is known.
+     */
+    [[gnu::cold]]
+    void require_shared(uint8_t i, const ::tour& other, std::optional<unsigned> k) {
+        if (this->overlap) {
+            this->model.remove(*this->overlap);
+            this->overlap.reset();
+        }
+        if (!k) {
+            return;
+        }
+        auto expr = GRBLinExpr();
+        for (unsigned idx = 0; idx < other.size(); idx++) {
+            expr += this->vars[i][other[idx]][other[(idx + 1) % other.size()]];
+        }
+        this->overlap = this->model.addConstr(expr, GRB_GREATER_EQUAL, *k);
+    }
+
+    /** Time limit for each `solve()`, in seconds, or none when empty. */
+    [[gnu::cold]]
+    void time_limit(std::optional<double> seconds) {
+        this->model.set(GRB_DoubleParam_TimeLimit, seconds.value_or(GRB_INFINITY));
+    }
+
+    /** Stops the running `solve()` as soon as possible; safe to call from another thread. */
+    [[gnu::cold]]
+    void terminate() {
+        this->model.terminate();
+    }
+
+    /** Write branch-and-bound nodes to `dir` when they use more than `gigabytes` of memory. */
+    [[gnu::cold]]
+    void spill_nodes(double gigabytes, const std::string& dir) {
+        this->model.set(GRB_DoubleParam_NodefileStart, gigabytes);
+        this->model.set(GRB_StringParam_NodefileDir, dir);
+    }
+
     [[gnu::hot]]
-    double solve() {
-        auto callback = subtour_elim(this->vertices, this->vars);
+    double solve(termination& control, memory_guard& guard) {
+        if (auto gigabytes = guard.nodefile_start()) {
+            this->spill_nodes(*gigabytes, guard.nodefile_dir);
+        }
+        // rows kept from earlier solves can only go before this one starts
+        if (guard.poll() >= memory_guard::level::shed) [[unlikely]] {
+            this->cuts.shed();
+            this->shed_cuts();
+        }
+
+        auto callback = subtour_elim(this->vertices, this->vars, control, guard, this->cuts);
+        callback.separate = (this->form == formulation::lazy);
+        callback.patch = this->patching;
+        callback.similarity = this->k;
+        callback.weights = this->weights;
+        callback.shared = this->shared;
+        callback.inbox = this->inbox;
+        callback.progress = this->progress;
+        callback.cache = &this->fingerprints;
+        callback.incumbent = &this->incumbent;
+        callback.trace = this->trace;
         this->model.setCallback(&callback);
 
+        control.enter(termination::phase::exact);
         this->model.optimize();
         auto total_time = this->elapsed();
+        this->patched += callback.patched;
+        this->received += callback.received;
+        this->separation += callback.separation_secs;
+
+        control.stop(solver_status(this->model.get(GRB_IntAttr_Status)));
 
         if (this->solution_count() <= 0) [[unlikely]] {
             throw utils::invalid_solution::zero_solutions(this->vertices);
@@ -192,6 +792,16 @@ public:
         return this->model.get(GRB_DoubleAttr_ObjVal);
     }
 
+    [[gnu::pure]] [[gnu::cold]]
+    double bound() const {
+        return this->model.get(GRB_DoubleAttr_ObjBound);
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    double gap() const {
+        return termination::gap(this->solution_cost(), this->bound());
+    }
+
     [[gnu::pure]] [[gnu::hot]]
     inline bool edge(uint8_t i, unsigned u, unsigned v) const {
         if (u != v) [[likely]] {
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <csignal>
+#include <iostream>
+
+
+/**
+ * Signals handled by setting lock-free flags, which the solver polls from its callback: SIGUSR1
+ * asks for a status snapshot and SIGINT or SIGTERM for a cooperative stop, after which the
+ * report is still printed. A second SIGINT or SIGTERM kills the process as usual.
+ */
+namespace interrupts {
+    static_assert(std::atomic<bool>::is_always_lock_free);
+
+    /** Set by SIGINT or SIGTERM; polled by every `termination` and by loops over several solves. */
+    inline std::atomic<bool> stop = false;
+    /** Set by SIGUSR1, until taken by `snapshot_requested()`. */
+    inline std::atomic<bool> snapshot = false;
+    /** Last stop signal received, or zero. */
+    inline volatile std::sig_atomic_t received = 0;
+
+    [[gnu::cold]] [[gnu::nothrow]]
+    static inline void on_signal(int signal) noexcept {
+        if (signal == SIGUSR1) {
+            snapshot.store(true, std::memory_order_relaxed);
+            return;
+        }
+        if (stop.exchange(true, std::memory_order_relaxed)) [[unlikely]] {
+            std::signal(signal, SIG_DFL);
+            std::raise(signal);
+            return;
+        }
+        received = signal;
+    }
+
+    /** Whether a snapshot was asked for since the last call. */
+    [[gnu::hot]] [[gnu::nothrow]]
+    static inline bool snapshot_requested() noexcept {
+        return snapshot.load(std::memory_order_relaxed) && snapshot.exchange(false, std::memory_order_relaxed);
+    }
+
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    static inline const char *name(int signal) noexcept {
+        switch (signal) {
+            case SIGINT:
+                return "SIGINT";
+            case SIGTERM:
+                return "SIGTERM";
+            case SIGALRM:
+                return "timeout";
+            default:
+                return "signal";
+        }
+    }
+
+    [[gnu::cold]]
+    static inline void setup() {
+        for (int signal : { SIGINT, SIGTERM, SIGUSR1 }) {
+            if (std::signal(signal, on_signal) == SIG_ERR) [[unlikely]] {
+                std::cerr << "Warning: could not handle signal " << signal << "." << std::endl;
+            }
+        }
+    }
+}
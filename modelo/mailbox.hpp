@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+#include "tour.hpp"
+#include "vertex.hpp"
+
+
+/** Best tour pair posted by threads of this process, for the main solve to pick up. */
+struct mailbox final {
+private:
+    mutable std::mutex lock;
+    utils::pair<tour> tours;
+    double cost = INFINITY;
+    uint64_t version = 0;
+
+public:
+    /** Keeps the pair if cheaper than the one already posted, returning whether it was. */
+    [[gnu::cold]]
+    bool post(const utils::pair<tour>& tours, double cost) {
+        auto guard = std::lock_guard(this->lock);
+        if (cost >= this->cost) {
+            return false;
+        }
+        this->tours = tours;
+        this->cost = cost;
+        this->version++;
+        return true;
+    }
+
+    /**
+     * The posted pair, if it changed since version `seen` and is cheaper than `best`. Updates
+     * `seen` either way.
+     */
+    [[gnu::hot]]
+    std::optional<utils::pair<tour>> take(uint64_t& seen, double best) const {
+        auto guard = std::lock_guard(this->lock);
+        if (this->version == seen) [[likely]] {
+            return std::nullopt;
+        }
+        seen = this->version;
+        if (this->cost >= best) {
+            return std::nullopt;
+        }
+        return this->tours;
+    }
+};
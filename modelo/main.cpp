@@ -1,5 +1,6 @@
 #include <chrono>
 #include <csignal>
+#include <fstream>
 #include <optional>
 #include <span>
 #include <stdexcept>
@@ -8,6 +9,16 @@
 #include <vector>
 
 #include "graph.hpp"
+#include "pareto.hpp"
+#include "alternate.hpp"
+#include "anytime.hpp"
+#include "dynamic.hpp"
+#include "generator.hpp"
+#include "interrupts.hpp"
+#include "paths.hpp"
+#include "relaxfix.hpp"
+#include "seeds.hpp"
+#include "selector.hpp"
 #include "coordinates.hpp"
 #include "argparse.hpp"
 
@@ -26,6 +37,9 @@ namespace utils {
 struct program final {
 private:
     argparse::ArgumentParser args;
+    std::optional<engine_selector::selection> selected;
+    /** Random instance from `--generate`, used instead of the default vertices when not empty. */
+    std::vector<vertex> generated;
 
     [[gnu::cold]]
     explicit inline program(std::string name): args(name) {
@@ -34,11 +48,39 @@ private:
             .default_value<unsigned>(100)
             .scan<'u', unsigned>();
 
+        this->args.add_argument("--generate")
+            .help("solve a random instance of --nodes vertices, at the density of the default one")
+            .default_value(false)
+            .implicit_value(true);
+
+        this->args.add_argument("--seed")
+            .help("seed for --generate")
+            .default_value<unsigned>(1)
+            .scan<'u', unsigned>();
+
         this->args.add_argument("-k", "--similarity")
             .help("minimun number of shared edges between tours")
             .default_value<unsigned>(0)
             .scan<'u', unsigned>();
 
+        this->args.add_argument("-f", "--formulation")
+            .help("subtour elimination: 'lazy' constraints, single-commodity 'flow' or 'mtz'")
+            .default_value(std::string("lazy"));
+
+        this->args.add_argument("--coupling")
+            .help("shared edges: 'quadratic' product, linear 'edges' or generated 'paths' (price-and-branch)")
+            .default_value(std::string("quadratic"));
+
+        this->args.add_argument("--root-only")
+            .help("with a linear coupling, only solve the root LP and report its bound")
+            .default_value(false)
+            .implicit_value(true);
+
+        this->args.add_argument("--no-shrink")
+            .help("with a linear coupling, run the root minimum cuts on the whole support graph")
+            .default_value(false)
+            .implicit_value(true);
+
         this->args.add_argument("--timeout")
             .help("execution timeout (in minutes), disabled if zero or negative")
             .default_value<double>(30.0)
@@ -48,6 +90,113 @@ private:
             .help("show vertices present on each solution")
             .default_value(false)
             .implicit_value(true);
+
+        this->args.add_argument("--incumbent")
+            .help("write both tours of the final incumbent to this file, also when stopped by SIGINT or SIGTERM");
+
+        this->args.add_argument("--record-trace")
+            .help("write every integer solution and node relaxation seen by the callback to this file, for 'replay'");
+
+        this->args.add_argument("--no-patch")
+            .help("do not patch rejected solutions into incumbents")
+            .default_value(false)
+            .implicit_value(true);
+
+        this->args.add_argument("--exchange")
+            .help("share incumbents and subtour cuts with concurrent processes solving the same instance")
+            .default_value(false)
+            .implicit_value(true);
+
+        this->args.add_argument("--relax-fix")
+            .help("run a relax-and-fix heuristic on another thread, limited by --heuristic-budget, feeding incumbents to the main solve")
+            .default_value(false)
+            .implicit_value(true);
+
+        this->args.add_argument("--alternate")
+            .help("start from alternating optimization, fixing each tour in turn and solving for the other, limited by --heuristic-budget")
+            .default_value(false)
+            .implicit_value(true);
+
+        this->args.add_argument("--select")
+            .help("choose formulation, coupling and heuristics from instance features, overriding the options given")
+            .default_value(false)
+            .implicit_value(true);
+
+        this->args.add_argument("--explain")
+            .help("show the instance features and why the engine was chosen (implies --select)")
+            .default_value(false)
+            .implicit_value(true);
+
+        this->args.add_argument("--rules")
+            .help("engine selection rules trained by 'batch --retrain', instead of the built-in ones");
+
+        this->args.add_argument("--seed-cuts")
+            .help("add subtour sets from spatial clusters and heuristic tour segments as lazy rows before solving")
+            .default_value(false)
+            .implicit_value(true);
+
+        this->args.add_argument("--cut-pool")
+            .help("file with subtour sets from a previous run, loaded as lazy rows if it exists and overwritten after solving");
+
+        this->args.add_argument("--pareto")
+            .help("enumerate the supported Pareto frontier between both tour costs, solving up to this many models")
+            .default_value<unsigned>(0)
+            .scan<'u', unsigned>();
+
+        this->args.add_argument("--epsilon")
+            .help("extra epsilon-constraint points between the frontier extremes")
+            .default_value<unsigned>(0)
+            .scan<'u', unsigned>();
+
+        this->args.add_argument("--frontier")
+            .help("file for the frontier points (as CSV), instead of the standard output");
+
+        this->args.add_argument("--changes")
+            .help("file with batches of vertex insertions and removals, re-optimized after each batch");
+
+        this->args.add_argument("--what-if")
+            .help("file with batches of vertex moves and cost space scalings, comparing re-optimization against a cold solve");
+
+        this->args.add_argument("--target-gap")
+            .help("stop when the relative optimality gap reaches this value")
+            .scan<'g', double>();
+
+        this->args.add_argument("--target-objective")
+            .help("stop when the incumbent cost reaches this value")
+            .scan<'g', double>();
+
+        this->args.add_argument("--stall")
+            .help("stop after this many seconds without improving incumbent or bound")
+            .scan<'g', double>();
+
+        this->args.add_argument("--node-limit")
+            .help("stop after exploring this many branch-and-bound nodes")
+            .scan<'g', double>();
+
+        this->args.add_argument("--heuristic-budget")
+            .help("time limit for the heuristic phase (in seconds)")
+            .scan<'g', double>();
+
+        this->args.add_argument("--exact-budget")
+            .help("time limit for the exact phase (in seconds)")
+            .scan<'g', double>();
+
+        this->args.add_argument("--threads")
+            .help("threads for each Gurobi model, or zero for its default")
+            .default_value<unsigned>(0)
+            .scan<'u', unsigned>();
+
+        this->args.add_argument("--solver-seed")
+            .help("random seed for Gurobi, to measure performance variability")
+            .scan<'i', int>();
+
+        this->args.add_argument("--memory")
+            .help("memory budget (in MiB): spill nodes, shed inactive cuts between solves and stop cleanly when approaching it")
+            .scan<'g', double>();
+
+        this->args.add_argument("--nodefile-dir")
+            .help("directory for node files when spilling")
+            .default_value(std::string("."));
     }
 
 public:
@@ -61,9 +210,29 @@ public:
             std::cerr << this->args << std::endl;
             std::exit(EXIT_FAILURE);
         }
+
+        // every model is created afterwards, so they all inherit it
+        if (const auto threads = this->args.get<unsigned>("threads"); threads > 0) {
+            this->env.set(GRB_IntParam_Threads, (int) threads);
+        }
+        if (const auto seed = this->args.present<int>("solver-seed")) {
+            this->env.set(GRB_IntParam_Seed, *seed);
+        }
+
+        if (this->args.get<bool>("generate")) {
+            this->generated = utils::random_vertices(this->nodes(), this->args.get<unsigned>("seed"));
+        }
+
+        // too many nodes is reported by `run`
+        const bool select = this->args.get<bool>("select") || this->args.get<bool>("explain");
+        if (select && (this->nodes() <= DEFAULT_VERTICES.size() || !this->generated.empty())) {
+            const auto rules = this->args.present<std::string>("rules");
+            const auto selector = rules ? engine_selector::load(*rules) : engine_selector();
+            this->selected = selector.choose(instance_features::of(this->vertices(), this->similarity()));
+        }
     }
 
-    const GRBEnv env = utils::quiet_env();
+    GRBEnv env = utils::quiet_env();
 
     [[gnu::pure]] [[gnu::cold]]
     inline unsigned nodes() const {
@@ -75,6 +244,29 @@ public:
         return this->args.get<unsigned>("similarity");
     }
 
+    [[gnu::pure]] [[gnu::cold]]
+    inline formulation form() const {
+        return parse_formulation(this->used().formulation);
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline coupling couple() const {
+        return parse_coupling(this->used().coupling);
+    }
+
+    /** The selected engine, or the one given by the options. */
+    [[gnu::pure]] [[gnu::cold]]
+    engine used() const {
+        if (this->selected) {
+            return this->selected->chosen;
+        }
+        return engine {
+            this->args.get<std::string>("formulation"),
+            this->args.get<std::string>("coupling"),
+            this->args.get<bool>("relax-fix"),
+        };
+    }
+
     [[gnu::pure]] [[gnu::cold]]
     inline std::optional<double> timeout() const {
         auto value = this->args.get<double>("timeout");
@@ -90,9 +282,39 @@ public:
         return this->args.get<bool>("tour");
     }
 
+    [[gnu::pure]] [[gnu::cold]]
+    inline memory_guard guard() const {
+        return memory_guard::with_mebibytes(
+            this->args.present<double>("memory"),
+            this->args.get<std::string>("nodefile-dir")
+        );
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline bool patching() const {
+        return !this->args.get<bool>("no-patch");
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline termination::criteria criteria() const {
+        return termination::criteria {
+            .gap = this->args.present<double>("target-gap"),
+            .objective = this->args.present<double>("target-objective"),
+            .stall = this->args.present<double>("stall"),
+            .nodes = this->args.present<double>("node-limit"),
+            .budget = {
+                this->args.present<double>("heuristic-budget"),
+                this->args.present<double>("exact-budget"),
+            },
+        };
+    }
+
 private:
     [[gnu::cold]]
     inline std::span<const vertex> vertices() const {
+        if (!this->generated.empty()) {
+            return this->generated;
+        }
         if (this->nodes() > DEFAULT_VERTICES.size()) [[unlikely]] {
             throw utils::not_enough_items::in(DEFAULT_VERTICES, this->nodes());
         }
@@ -101,25 +323,200 @@ private:
 
     [[gnu::cold]]
     graph map() const {
-        return graph(this->vertices(), this->env, this->similarity());
+        return graph(this->vertices(), this->env, this->similarity(), this->form());
     }
 
-public:
-    [[gnu::hot]]
-    void run() const {
-        auto g = this->map();
-        std::cout << "Graph(n=" << g.order() << ",m=" << g.size() << ")" << std::endl;
+    [[gnu::cold]]
+    void frontier(graph& g) const {
+        auto guard = this->guard();
+        auto search = pareto(g, this->criteria(), guard);
+
+        auto points = search.supported(this->args.get<unsigned>("pareto"));
+        auto extra = search.epsilon(points, this->args.get<unsigned>("epsilon"));
+        points.insert(points.end(), extra.begin(), extra.end());
+        this->report_interrupt();
+
+        double total = 0.0;
+        for (const auto& point : search.points()) {
+            total += point.secs;
+        }
+        std::cout << "Frontier points: " << points.size() << std::endl;
+        std::cout << "Models solved: " << search.points().size() << std::endl;
+        std::cout << "Execution time: " << total << " secs" << std::endl;
+
+        auto file = std::ofstream();
+        if (auto path = this->args.present<std::string>("frontier")) {
+            file.open(*path);
+        }
+        std::ostream& out = file.is_open() ? file : std::cout;
+
+        pareto_point::header(out) << std::endl;
+        for (const auto& point : points) {
+            out << point << std::endl;
+        }
+    }
+
+    /** Status of the running solve, asked for by SIGUSR1. */
+    [[gnu::cold]]
+    static void snapshot(const graph& g, const termination& control, double best, double bound, double nodes) {
+        const double heuristic = control.elapsed(termination::phase::heuristic);
+        const double exact = control.elapsed(termination::phase::exact);
+        std::cerr << "Snapshot after " << heuristic + exact << " secs:" << std::endl;
+        std::cerr << "    Incumbent: " << best << " (tour 1: " << g.incumbent[0] << ", tour 2: " << g.incumbent[1] << ")" << std::endl;
+        std::cerr << "    Best bound: " << bound << std::endl;
+        std::cerr << "    Optimality gap: " << termination::gap(best, bound) << std::endl;
+        std::cerr << "    Nodes: " << nodes << std::endl;
+        std::cerr << "    Subtour cuts: " << g.cuts.total() << std::endl;
+        std::cerr << "    Heuristic phase: " << heuristic << " secs" << std::endl;
+        std::cerr << "    Exact phase: " << exact << " secs" << std::endl;
+    }
+
+    [[gnu::cold]]
+    void save_incumbent(const graph& g, const std::string& path) const {
+        auto file = std::ofstream(path);
+        for (uint8_t i = 0; i <= 1; i++) {
+            file << "Tour " << i+1 << ":" << std::endl;
+            file << utils::join(g.solution(i), "\n") << std::endl;
+        }
+    }
+
+    /** Says why the search stopped early, outside the signal handlers that asked for it. */
+    [[gnu::cold]]
+    void report_interrupt() const {
+        if (interrupts::received == SIGALRM) [[unlikely]] {
+            std::cerr << "Timeout: stopping execution for taking too long." << std::endl;
+            std::cerr << "Instance has been running for " << this->timeout().value_or(0) << " minutes." << std::endl;
+        }
+        if (interrupts::received != 0) [[unlikely]] {
+            std::cerr << "Interrupted by " << interrupts::name(interrupts::received) << ", reporting the incumbent." << std::endl;
+        }
+    }
 
-        const auto elapsed = g.solve();
+    [[gnu::hot]]
+    void single(graph& g) const {
+        auto control = termination(this->criteria());
+        // seeding and alternation, until `graph::solve` enters the exact phase
+        control.enter(termination::phase::heuristic);
+        auto guard = this->guard();
+        auto shared = std::optional<exchange>();
+        if (this->args.get<bool>("exchange")) {
+            g.shared = &shared.emplace(g.vertices, g.k);
+        }
+        auto inbox = mailbox();
+        auto heuristic = std::optional<relax_and_fix>();
+        if (this->used().relax_fix) {
+            heuristic.emplace(g.vertices, g.k, inbox, guard, this->args.present<double>("heuristic-budget"),
+                this->args.get<unsigned>("threads"), this->args.present<int>("solver-seed"));
+            g.inbox = &inbox;
+        }
+        auto trace = std::optional<trace_writer>();
+        if (auto path = this->args.present<std::string>("record-trace")) {
+            g.trace = &trace.emplace(*path, (unsigned) g.order());
+        }
+        auto seeds = this->seed_cuts(g);
+        auto alternation = std::optional<alternating>();
+        if (this->args.get<bool>("alternate")) {
+            alternation.emplace(g.vertices, this->env, g.k);
+            g.set_start(alternation->run(guard, std::nullopt, this->args.present<double>("heuristic-budget")));
+        }
+        auto path = trajectory();
+        const auto clock = [&control]() {
+            return control.elapsed(termination::phase::heuristic) + control.elapsed(termination::phase::exact);
+        };
+        g.progress = [&g, &control, &path, &clock](double best, double bound, double nodes) {
+            path.add(clock(), best, bound);
+            if (interrupts::snapshot_requested()) [[unlikely]] {
+                snapshot(g, control, best, bound, nodes);
+            }
+        };
+        double elapsed = 0.0;
+        try {
+            elapsed = g.solve(control, guard);
+        } catch (const utils::invalid_solution&) {
+            // stopped before the first incumbent, the search so far is still reported
+            if (control.why() != termination::reason::cancelled) {
+                throw;
+            }
+            elapsed = g.elapsed();
+        }
+        const bool found = g.solution_count() > 0;
+        g.shared = nullptr;
+        g.inbox = nullptr;
+        g.progress = nullptr;
+        g.trace = nullptr;
+        this->report_interrupt();
+        if (heuristic) {
+            heuristic->stop();
+        }
         std::cout << "Found " << g.solution_count() << " solution(s)."  << std::endl;
+        std::cout << "Stop reason: " << control.why() << std::endl;
         std::cout << "Iterations: " << g.iterations() << std::endl;
         std::cout << "Execution time: " << elapsed << " secs" << std::endl;
         std::cout << "Variables: " << g.var_count() << std::endl;
         std::cout << "Constraints: " << g.constr_count() << std::endl;
         std::cout << "    Linear: " << g.lin_constr_count() << std::endl;
         std::cout << "    Quadratic: " << g.quad_constr_count() << std::endl;
-        std::cout << "Similarity: " << g.similarity() << std::endl;
-        std::cout << "Objective cost: " << g.solution_cost() << std::endl;
+        if (found) [[likely]] {
+            std::cout << "Similarity: " << g.similarity() << std::endl;
+            std::cout << "Objective cost: " << g.solution_cost() << std::endl;
+        }
+        std::cout << "Best bound: " << g.bound() << std::endl;
+        if (found) [[likely]] {
+            std::cout << "Optimality gap: " << g.gap() << std::endl;
+        }
+        std::cout << "Heuristic phase: " << control.elapsed(termination::phase::heuristic) << " secs" << std::endl;
+        std::cout << "Exact phase: " << control.elapsed(termination::phase::exact) << " secs" << std::endl;
+        std::cout << "Subtour cuts: " << g.cuts.total() << std::endl;
+        std::cout << "Separation time: " << g.separation << " secs" << std::endl;
+        std::cout << "Cut pool: " << g.cuts.size() << std::endl;
+        std::cout << "Solution cache: " << g.fingerprints.hits() << " hits of " << g.fingerprints.queries()
+            << " (" << g.fingerprints.hit_rate() << ")" << std::endl;
+        std::cout << "Patched solutions: " << g.patched << std::endl;
+        if (trace) {
+            std::cout << "Traced points: " << trace->size() << std::endl;
+        }
+        path.finish(clock(), found ? std::optional(g.solution_cost()) : std::nullopt, g.bound());
+        std::cout << "Trajectory: " << path << std::endl;
+        if (alternation) {
+            for (const auto& step : alternation->steps()) {
+                std::cout << "Alternating step: cost " << step.cost << " after " << step.secs << " secs"
+                    << " (tour " << step.fixed+1 << " fixed, " << step.solves << " solve(s)" << (step.exact ? ", exact" : "") << ")" << std::endl;
+            }
+            if (!alternation->steps().empty()) {
+                std::cout << "Alternating cost: " << alternation->steps().back().cost << std::endl;
+            }
+        }
+        if (seeds) {
+            std::cout << "Seeded cuts: " << seeds->sets().size()
+                << " (clusters " << seeds->count(cut_seeds::source::clusters)
+                << ", segments " << seeds->count(cut_seeds::source::segments)
+                << ", persisted " << seeds->count(cut_seeds::source::persisted) << ")" << std::endl;
+        }
+        if (auto path = this->args.present<std::string>("cut-pool")) {
+            auto file = std::ofstream(*path);
+            g.cuts.save(file, g.vertices);
+            // persisted sets are model rows now, so the callback does not find them again
+            for (const auto& [set, level] : seeds->sets()) {
+                if (level == cut_seeds::level(cut_seeds::source::persisted) && !g.cuts.contains(set)) {
+                    cut_pool::write(file, set, g.vertices);
+                }
+            }
+        }
+        if (shared) {
+            std::cout << "Shared incumbents: " << shared->published << " published, " << shared->received << " received" << std::endl;
+            std::cout << "Shared cuts: " << shared->cuts_published << " published, " << shared->cuts_received << " received" << std::endl;
+        }
+        if (heuristic) {
+            for (const auto& found : heuristic->incumbents()) {
+                std::cout << "Relax-and-fix incumbent: cost " << found.cost << " after " << found.secs << " secs"
+                    << " (threshold " << found.threshold << ", " << found.fixed << " fixed)" << std::endl;
+            }
+            std::cout << "Relax-and-fix incumbents used: " << g.received << std::endl;
+        }
+        std::cout << "Peak memory: " << memory_guard::peak() / (1024. * 1024.) << " MiB" << std::endl;
+        if (!found) [[unlikely]] {
+            return;
+        }
 
         for (uint8_t i = 0; i <= 1; i++) {
             const auto solution = g.solution(i);
@@ -128,21 +525,198 @@ public:
                 std::cout << utils::join(solution, "\n") << std::endl;
             }
         }
+        if (auto path = this->args.present<std::string>("incumbent")) {
+            this->save_incumbent(g, *path);
+        }
+    }
+
+    /** Candidate subtour sets added to `g` as lazy rows, if asked for. */
+    [[gnu::cold]]
+    std::optional<cut_seeds> seed_cuts(graph& g) const {
+        const auto path = this->args.present<std::string>("cut-pool");
+        if (!this->args.get<bool>("seed-cuts") && !path) {
+            return std::nullopt;
+        }
+        auto seeds = cut_seeds(g.vertices);
+        if (this->args.get<bool>("seed-cuts")) {
+            seeds.clusters();
+            seeds.segments();
+        }
+        if (path) {
+            if (auto file = std::ifstream(*path)) {
+                seeds.persisted(file);
+            }
+        }
+        g.seed_cuts(seeds.sets());
+        return seeds;
+    }
+
+    [[gnu::cold]]
+    void changes(graph& g, const std::string& filename) const {
+        auto instance = dynamic_instance(g);
+        auto guard = this->guard();
+
+        const auto batches = vertex_change::read_batches(filename);
+        for (size_t b = 0; b < batches.size(); b++) {
+            for (const auto& change : batches[b]) {
+                instance.apply(change);
+            }
+
+            auto control = termination(this->criteria());
+            const auto elapsed = instance.reoptimize(control, guard);
+            std::cout << "Batch " << b+1 << ": " << batches[b].size() << " change(s), n=" << g.order()
+                << ", cost " << g.solution_cost() << ", " << control.why() << " in " << elapsed << " secs" << std::endl;
+            if (interrupts::stop) [[unlikely]] {
+                break;
+            }
+        }
+    }
+
+    [[gnu::cold]]
+    void what_if(graph& g, const std::string& filename) const {
+        auto instance = dynamic_instance(g);
+        auto guard = this->guard();
+
+        const auto batches = cost_change::read_batches(filename);
+        for (size_t b = 0; b < batches.size(); b++) {
+            const auto updated = instance.apply(batches[b]);
+            auto warm = termination(this->criteria());
+            const auto warm_secs = instance.reoptimize(warm, guard);
+            const auto warm_cost = g.solution_cost();
+
+            const auto start = std::chrono::steady_clock::now();
+            auto cold = termination(this->criteria());
+            auto scratch = graph(g.vertices, this->env, this->similarity(), this->form());
+            scratch.patching = this->patching();
+            scratch.solve(cold, guard);
+            const std::chrono::duration<double> cold_secs = std::chrono::steady_clock::now() - start;
+
+            std::cout << "What-if " << b+1 << ": " << updated << " coefficient(s) updated" << std::endl;
+            std::cout << "    Re-optimized: cost " << warm_cost << ", " << warm.why() << " in " << warm_secs << " secs" << std::endl;
+            std::cout << "    Cold solve: cost " << scratch.solution_cost() << ", " << cold.why() << " in " << cold_secs.count() << " secs" << std::endl;
+            if (interrupts::stop) [[unlikely]] {
+                break;
+            }
+        }
+    }
+
+    [[gnu::cold]]
+    void explain() const {
+        // the instance is too large, `map` reports it
+        if (!this->selected) [[unlikely]] {
+            return;
+        }
+        std::cout << "Features: " << instance_features::of(this->vertices(), this->similarity()) << std::endl;
+        for (const auto& [name, secs] : this->selected->predicted) {
+            std::cout << "Predicted " << name << ": " << secs << " secs" << std::endl;
+        }
+        for (const auto& reason : this->selected->reasons) {
+            std::cout << "Selection reason: " << reason << std::endl;
+        }
+    }
+
+    [[gnu::cold]]
+    void coupled() const {
+        const auto start = std::chrono::steady_clock::now();
+        auto m = coupled_model(this->vertices(), this->env, this->similarity(), this->couple());
+        const std::chrono::duration<double> build = std::chrono::steady_clock::now() - start;
+        std::cout << "Graph(n=" << m.order() << ")" << std::endl;
+        std::cout << "Build time: " << build.count() << " secs" << std::endl;
+        std::cout << "Coupling: " << m.mode << std::endl;
+        m.shrinking = !this->args.get<bool>("no-shrink");
+
+        const auto root = m.root();
+        std::cout << "Root bound: " << root.bound << (root.exact ? "" : " (heuristic pricing)") << std::endl;
+        std::cout << "Root time: " << root.secs << " secs" << std::endl;
+        std::cout << "Root rounds: " << root.rounds << std::endl;
+        std::cout << "Root cuts: " << root.cuts << std::endl;
+        std::cout << "Separation time: " << root.separation << " secs" << std::endl;
+        std::cout << "Support graph: " << root.support << " vertices, " << root.shrunk << " after shrinking" << std::endl;
+        std::cout << "Columns: " << root.columns << std::endl;
+        if (this->args.get<bool>("root-only")) {
+            return;
+        }
+
+        auto control = termination(this->criteria());
+        auto guard = this->guard();
+        const auto elapsed = m.solve(control, guard);
+        std::cout << "Stop reason: " << control.why() << std::endl;
+        std::cout << "Execution time: " << elapsed << " secs" << std::endl;
+        std::cout << "Objective cost: " << m.solution_cost() << std::endl;
+        std::cout << "Best bound: " << m.bound() << std::endl;
+        std::cout << "Optimality gap: " << termination::gap(m.solution_cost(), m.bound()) << std::endl;
+        std::cout << "Subtour cuts: " << m.cuts.total() << std::endl;
+
+        const auto tours = utils::pair<::tour> { m.tour(0), m.tour(1) };
+        std::cout << "Similarity: " << ::tour::shared(tours[0], tours[1], m.order()) << std::endl;
+        std::cout << "Peak memory: " << memory_guard::peak() / (1024. * 1024.) << " MiB" << std::endl;
+        for (uint8_t i = 0; i <= 1; i++) {
+            std::cout << "Tour " << i+1 << ": total cost " << tours[i].cost(i, m.vertices) << std::endl;
+        }
+    }
+
+public:
+    [[gnu::hot]]
+    void run() const {
+        if (this->args.get<bool>("explain")) {
+            this->explain();
+        }
+        std::cout << "Engine: " << this->used().name() << std::endl;
+        if (const auto threads = this->args.get<unsigned>("threads"); threads > 0) {
+            std::cout << "Threads: " << threads << std::endl;
+        }
+        if (const auto seed = this->args.present<int>("solver-seed")) {
+            std::cout << "Solver seed: " << *seed << std::endl;
+        }
+        if (this->couple() != coupling::quadratic) {
+            this->coupled();
+            return;
+        }
+        const auto start = std::chrono::steady_clock::now();
+        auto g = this->map();
+        const std::chrono::duration<double> build = std::chrono::steady_clock::now() - start;
+        std::cout << "Graph(n=" << g.order() << ",m=" << g.size() << ")" << std::endl;
+        std::cout << "Build time: " << build.count() << " secs" << std::endl;
+        std::cout << "Formulation: " << g.form << std::endl;
+        g.patching = this->patching();
+
+        if (this->args.get<unsigned>("pareto") > 0) {
+            this->frontier(g);
+        } else {
+            this->single(g);
+        }
+
+        if (auto filename = this->args.present<std::string>("changes")) {
+            this->changes(g, *filename);
+        }
+        if (auto filename = this->args.present<std::string>("what-if")) {
+            this->what_if(g, *filename);
+        }
     }
 };
 
 namespace timeout {
-    static auto start = std::chrono::steady_clock::now();
+    /** Seconds given to the cooperative stop before exiting anyway. */
+    static constexpr unsigned GRACE = 30;
 
+    /**
+     * The first alarm stops the solve like SIGINT, so the report and trajectory are still
+     * printed. If it is still running after `GRACE`, e.g. while building a model, it exits.
+     */
     [[gnu::cold]] [[gnu::nothrow]]
     static void on_timeout(int signal) noexcept {
         if (signal == SIGALRM) [[likely]] {
-            const auto end = std::chrono::steady_clock::now();
-            std::chrono::duration<double, std::ratio<60>> elapsed = end - start;
-
-            std::cerr << "Timeout: stopping execution for taking too long." << std::endl;
-            std::cerr << "Instance has been running for " << elapsed.count() << " minutes." << std::endl;
-            std::exit(EXIT_FAILURE);
+            // reported by the solve, as for SIGINT
+            if (!interrupts::stop.exchange(true)) [[likely]] {
+                interrupts::received = SIGALRM;
+                alarm(GRACE);
+                return;
+            }
+            // other threads may still be solving, so nothing that locks, unmaps or unwinds
+            static constexpr char MESSAGE[] = "Timeout: still running after the grace period, exiting.\n";
+            [[maybe_unused]] const auto written = write(STDERR_FILENO, MESSAGE, sizeof(MESSAGE) - 1);
+            exchange::release_active();
+            _exit(EXIT_FAILURE);
         }
     }
 
@@ -165,6 +739,7 @@ int main(int argc, const char * const argv[]) {
     if (auto minutes = program.timeout()) [[likely]] {
         timeout::setup(*minutes);
     }
+    interrupts::setup();
 
     try {
         program.run();
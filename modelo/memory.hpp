@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <sys/resource.h>
+#include <unistd.h>
+
+
+/** Watches the resident memory of the process against a fixed budget. */
+struct memory_guard final {
+public:
+    enum class level : uint8_t {
+        /** Below every threshold. */
+        normal,
+        /** Branch-and-bound nodes should go to disk. */
+        spill,
+        /** Inactive cuts should be dropped. */
+        shed,
+        /** The search should stop before running out of memory. */
+        critical,
+    };
+
+    /** Fractions of the budget where each level starts. */
+    static constexpr double SPILL = 0.50;
+    static constexpr double SHED = 0.80;
+    static constexpr double CRITICAL = 0.95;
+
+    /** Budget, in bytes, or no limit if empty. */
+    const std::optional<size_t> budget;
+    /** Where branch-and-bound nodes are written when spilling. */
+    const std::string nodefile_dir;
+
+    [[gnu::cold]]
+    explicit memory_guard(std::optional<size_t> budget = std::nullopt, std::string nodefile_dir = "."):
+        budget(budget), nodefile_dir(nodefile_dir)
+    { }
+
+    [[gnu::cold]]
+    static memory_guard with_mebibytes(std::optional<double> mebibytes, std::string nodefile_dir) {
+        if (mebibytes && *mebibytes > 0) {
+            return memory_guard((size_t) (*mebibytes * 1024 * 1024), nodefile_dir);
+        }
+        return memory_guard(std::nullopt, nodefile_dir);
+    }
+
+    /** Current resident set size of the process, in bytes. */
+    [[gnu::cold]]
+    static size_t resident() noexcept {
+        auto file = std::fopen("/proc/self/statm", "r");
+        if (file == nullptr) [[unlikely]] {
+            return 0;
+        }
+
+        unsigned long pages = 0, resident = 0;
+        const int count = std::fscanf(file, "%lu %lu", &pages, &resident);
+        std::fclose(file);
+
+        if (count != 2) [[unlikely]] {
+            return 0;
+        }
+        return resident * (size_t) sysconf(_SC_PAGESIZE);
+    }
+
+    /** Memory where node files start being used, in gigabytes as expected by `NodefileStart`. */
+    [[gnu::pure]] [[gnu::cold]]
+    inline std::optional<double> nodefile_start() const noexcept {
+        if (this->budget) {
+            return (*this->budget * SPILL) / (1024. * 1024. * 1024.);
+        }
+        return std::nullopt;
+    }
+
+    /** Samples the resident memory, at most once every `INTERVAL`. */
+    [[gnu::hot]]
+    level poll() noexcept {
+        if (!this->budget) [[likely]] {
+            return level::normal;
+        }
+
+        const auto now = clock::now();
+        if (now - this->sampled >= INTERVAL) {
+            this->sampled = now;
+            this->last = memory_guard::resident();
+        }
+
+        const double usage = (double) this->last / *this->budget;
+        if (usage >= CRITICAL) [[unlikely]] {
+            return level::critical;
+        } else if (usage >= SHED) [[unlikely]] {
+            return level::shed;
+        } else if (usage >= SPILL) {
+            return level::spill;
+        }
+        return level::normal;
+    }
+
+    /** Largest resident memory of the process so far, in bytes. */
+    [[gnu::cold]]
+    static size_t peak() noexcept {
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0) [[unlikely]] {
+            return 0;
+        }
+        return (size_t) usage.ru_maxrss * 1024;
+    }
+
+private:
+    using clock = std::chrono::steady_clock;
+    static constexpr auto INTERVAL = std::chrono::milliseconds(200);
+
+    clock::time_point sampled = clock::time_point();
+    size_t last = 0;
+};
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <span>
+#include <vector>
+
+#include "tour.hpp"
+
+
+/**
+ * Support graph of a point satisfying the degree equations, after the Padberg-Rinaldi shrinking
+ * rule: two nodes with `x(A:B) = 1` are merged, over and over. Every node stays a tight set
+ * (`x(delta(A)) = 2`), so if some subtour cut is violated, one that does not split a node is
+ * violated too, and the minimum cut can be searched on the smaller graph.
+ */
+struct shrunk_graph final {
+    /** Weights between the merged nodes. */
+    utils::matrix<double> weights;
+    /** Original vertices of each node. */
+    std::vector<std::vector<unsigned>> groups;
+
+    [[gnu::hot]]
+    static shrunk_graph padberg_rinaldi(const utils::matrix<double>& weights, double eps = 1e-6) {
+        const unsigned n = (unsigned) weights.size();
+        auto merged = utils::matrix<double>(n);
+        for (unsigned u = 0; u < n; u++) {
+            for (unsigned v = 0; v < n; v++) {
+                merged[u][v] = weights[u][v];
+            }
+        }
+        auto groups = std::vector<std::vector<unsigned>>(n);
+        for (unsigned v = 0; v < n; v++) {
+            groups[v] = { v };
+        }
+
+        // merging into `a` only changes the weights on `a`, so rescanning it until stable is enough
+        auto active = std::vector<bool>(n, true);
+        for (unsigned a = 0; a < n; a++) {
+            bool grown = active[a];
+            while (grown) {
+                grown = false;
+                for (unsigned b = 0; b < n; b++) {
+                    // above 1, the union is itself a violated set, so it must stay a cut
+                    if (b == a || !active[b] || std::abs(merged[a][b] - 1.0) > eps) [[likely]] {
+                        continue;
+                    }
+                    for (unsigned v = 0; v < n; v++) {
+                        merged[a][v] += merged[b][v];
+                        merged[v][a] = merged[a][v];
+                    }
+                    merged[a][a] = 0.0;
+                    groups[a].insert(groups[a].end(), groups[b].begin(), groups[b].end());
+                    active[b] = false;
+                    grown = true;
+                }
+            }
+        }
+
+        auto nodes = std::vector<unsigned>();
+        for (unsigned v = 0; v < n; v++) {
+            if (active[v]) {
+                nodes.push_back(v);
+            }
+        }
+        auto result = shrunk_graph { utils::matrix<double>(nodes.size()), {} };
+        for (unsigned u = 0; u < nodes.size(); u++) {
+            for (unsigned v = 0; v < nodes.size(); v++) {
+                result.weights[u][v] = merged[nodes[u]][nodes[v]];
+            }
+            result.groups.push_back(std::move(groups[nodes[u]]));
+        }
+        return result;
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline size_t size() const noexcept {
+        return this->groups.size();
+    }
+
+    /** Original vertices of the nodes in `side`, sorted. */
+    [[gnu::hot]]
+    std::vector<unsigned> expand(std::span<const unsigned> side) const {
+        auto vertices = std::vector<unsigned>();
+        for (unsigned node : side) {
+            vertices.insert(vertices.end(), this->groups[node].begin(), this->groups[node].end());
+        }
+        std::sort(vertices.begin(), vertices.end());
+        return vertices;
+    }
+};
+
+
+/** Global minimum cut of an undirected graph with non-negative edge weights. */
+struct min_cut final {
+    /** Total weight of the edges crossing the cut. */
+    double value;
+    /** Vertices on the smaller side of the cut. */
+    std::vector<unsigned> side;
+
+    /** Connected components of the edges with weight above `eps`. */
+    [[gnu::hot]]
+    static std::vector<std::vector<unsigned>> components(const utils::matrix<double>& weights, double eps = 1e-6) {
+        const unsigned n = (unsigned) weights.size();
+        auto component = std::vector<unsigned>(n, n);
+        auto found = std::vector<std::vector<unsigned>>();
+
+        auto stack = std::vector<unsigned>();
+        for (unsigned root = 0; root < n; root++) {
+            if (component[root] < n) [[likely]] {
+                continue;
+            }
+            const unsigned id = (unsigned) found.size();
+            found.emplace_back();
+            component[root] = id;
+            stack.push_back(root);
+
+            while (!stack.empty()) {
+                const unsigned u = stack.back();
+                stack.pop_back();
+                found[id].push_back(u);
+                for (unsigned v = 0; v < n; v++) {
+                    if (component[v] == n && weights[u][v] > eps) {
+                        component[v] = id;
+                        stack.push_back(v);
+                    }
+                }
+            }
+        }
+        return found;
+    }
+
+    /**
+     * Stoer-Wagner: `n - 1` maximum adjacency orderings, each one merging its last two vertices
+     * after recording the cut of the last one. `O(n^3)` on the dense matrix.
+     */
+    [[gnu::hot]]
+    static min_cut stoer_wagner(utils::matrix<double> weights) {
+        const unsigned n = (unsigned) weights.size();
+        auto groups = std::vector<std::vector<unsigned>>(n);
+        for (unsigned v = 0; v < n; v++) {
+            groups[v] = { v };
+        }
+
+        auto best = min_cut { INFINITY, {} };
+        auto merged = std::vector<bool>(n, false);
+        auto added = std::vector<bool>(n);
+        auto attach = std::vector<double>(n);
+
+        for (unsigned phase = 0; phase + 1 < n; phase++) {
+            std::fill(added.begin(), added.end(), false);
+            std::fill(attach.begin(), attach.end(), 0.0);
+            unsigned prev = n;
+
+            for (unsigned step = 0; step < n - phase; step++) {
+                unsigned sel = n;
+                for (unsigned v = 0; v < n; v++) {
+                    if (!merged[v] && !added[v] && (sel == n || attach[v] > attach[sel])) {
+                        sel = v;
+                    }
+                }
+
+                if (step + 1 < n - phase) [[likely]] {
+                    added[sel] = true;
+                    for (unsigned v = 0; v < n; v++) {
+                        attach[v] += weights[sel][v];
+                    }
+                    prev = sel;
+                    continue;
+                }
+
+                if (attach[sel] < best.value) {
+                    best = min_cut { attach[sel], groups[sel] };
+                }
+                for (unsigned v = 0; v < n; v++) {
+                    weights[prev][v] += weights[sel][v];
+                    weights[v][prev] = weights[prev][v];
+                }
+                weights[prev][prev] = 0.0;
+                groups[prev].insert(groups[prev].end(), groups[sel].begin(), groups[sel].end());
+                merged[sel] = true;
+            }
+        }
+
+        best.smaller_side(n);
+        std::sort(best.side.begin(), best.side.end());
+        return best;
+    }
+
+    /**
+     * `stoer_wagner` on a graph shrunk by `shrunk_graph::padberg_rinaldi`, with the side mapped
+     * back to the original vertices. The value is infinite when everything was merged, which
+     * means no cut is below 2.
+     */
+    [[gnu::hot]]
+    static min_cut stoer_wagner(shrunk_graph graph) {
+        if (graph.size() <= 1) {
+            return min_cut { INFINITY, {} };
+        }
+        unsigned n = 0;
+        for (const auto& group : graph.groups) {
+            n += (unsigned) group.size();
+        }
+
+        const auto cut = stoer_wagner(std::move(graph.weights));
+        auto best = min_cut { cut.value, graph.expand(cut.side) };
+        best.smaller_side(n);
+        return best;
+    }
+
+private:
+    /** Replaces `side` by its complement if it has more than half of the `n` vertices. */
+    [[gnu::hot]]
+    void smaller_side(unsigned n) {
+        if (2 * this->side.size() <= n) {
+            return;
+        }
+        auto inside = std::vector<bool>(n, false);
+        for (unsigned v : this->side) {
+            inside[v] = true;
+        }
+        this->side.clear();
+        for (unsigned v = 0; v < n; v++) {
+            if (!inside[v]) {
+                this->side.push_back(v);
+            }
+        }
+    }
+};
@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "moves.hpp"
+#include "neighbours.hpp"
+#include "cycle.hpp"
+#include "coordinates.hpp"
+#include "argparse.hpp"
+
+
+/** Moves evaluated per second by `move_kernel`, with and without SIMD, over random tours. */
+struct program final {
+private:
+    argparse::ArgumentParser args;
+
+    [[gnu::cold]]
+    explicit inline program(std::string name): args(name) {
+        this->args.add_argument("-n", "--nodes")
+            .help("sample size for the subgraph")
+            .default_value<unsigned>(250)
+            .scan<'u', unsigned>();
+
+        this->args.add_argument("-w", "--width")
+            .help("candidate list width")
+            .default_value<unsigned>(16)
+            .scan<'u', unsigned>();
+
+        this->args.add_argument("--rounds")
+            .help("passes over every vertex for each measurement")
+            .default_value<unsigned>(2000)
+            .scan<'u', unsigned>();
+
+        this->args.add_argument("--seed")
+            .help("seed for the random tour")
+            .default_value<unsigned>(1)
+            .scan<'u', unsigned>();
+    }
+
+    /** Seconds taken by `rounds` passes of `evaluate` over every vertex. */
+    template <typename Evaluate> [[gnu::hot]]
+    static double measure(unsigned rounds, unsigned n, Evaluate&& evaluate) {
+        const auto start = std::chrono::steady_clock::now();
+        for (unsigned round = 0; round < rounds; round++) {
+            for (unsigned a = 0; a < n; a++) {
+                evaluate(a);
+            }
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count();
+    }
+
+public:
+    [[gnu::cold]]
+    explicit program(const std::vector<std::string>& arguments): program(arguments[0]) {
+        try {
+            this->args.parse_args(arguments);
+
+        } catch (const std::runtime_error& err) {
+            std::cerr << err.what() << std::endl;
+            std::cerr << this->args << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    [[gnu::cold]]
+    void run() const {
+        const unsigned n = this->args.get<unsigned>("nodes");
+        if (n > DEFAULT_VERTICES.size()) [[unlikely]] {
+            throw utils::not_enough_items::in(DEFAULT_VERTICES, n);
+        }
+        const auto vertices = std::span(DEFAULT_VERTICES).first(n);
+        const unsigned rounds = this->args.get<unsigned>("rounds");
+
+        auto order = tour();
+        order.resize(n);
+        std::iota(order.begin(), order.end(), 0);
+        auto random = std::mt19937(this->args.get<unsigned>("seed"));
+        std::shuffle(order.begin(), order.end(), random);
+        const auto cyc = cycle(order);
+
+        const auto near = neighbours(0, vertices, this->args.get<unsigned>("width"));
+        const auto kernel = move_kernel(vertices);
+        auto deltas = move_deltas(), expected = move_deltas();
+
+        size_t mismatches = 0;
+        for (unsigned a = 0; a < n; a++) {
+            kernel.evaluate(cyc, a, near[a], deltas);
+            kernel.evaluate_scalar(cyc, a, near[a], expected);
+            mismatches += (deltas.values != expected.values);
+        }
+
+        // deltas are written to memory, so neither loop is optimized out
+        const double simd = measure(rounds, n, [&](unsigned a) { kernel.evaluate(cyc, a, near[a], deltas); });
+        const double scalar = measure(rounds, n, [&](unsigned a) { kernel.evaluate_scalar(cyc, a, near[a], deltas); });
+        const double moves = (double) rounds * n * near.width * move_deltas::KINDS * 2;
+
+        std::cout << "Vectorized: " << (move_kernel::VECTORIZED ? "AVX2" : "no") << std::endl;
+        std::cout << "Candidates: " << near.width << std::endl;
+        std::cout << "Moves evaluated: " << moves << std::endl;
+        std::cout << "Kernel: " << moves / simd << " moves/sec" << std::endl;
+        std::cout << "Scalar: " << moves / scalar << " moves/sec" << std::endl;
+        std::cout << "Speedup: " << scalar / simd << "x" << std::endl;
+        std::cout << "Mismatches: " << mismatches << std::endl;
+    }
+};
+
+
+int main(int argc, const char * const argv[]) {
+    const program program(std::vector<std::string>(argv, argv + argc));
+
+    try {
+        program.run();
+
+    } catch (const std::exception& err) {
+        std::cerr << "std::exception: " << err.what() << std::endl;
+        return EXIT_FAILURE;
+
+    } catch (...) {
+        std::cerr << "unknown exception!" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "cycle.hpp"
+#include "vertex.hpp"
+
+
+/**
+ * Move deltas for a vertex `a` against each of its candidates `c`, in both cost spaces.
+ *
+ * Indexed by space, then move, then candidate. Moves that are not possible for a candidate (it
+ * is a tour neighbour of `a`) have an infinite delta.
+ */
+struct move_deltas final {
+public:
+    enum class kind : uint8_t {
+        /** 2-opt replacing `(a, succ a)` and `(c, succ c)` by `(a, c)` and `(succ a, succ c)`. */
+        two_opt_succ = 0,
+        /** 2-opt replacing `(a, pred a)` and `(c, pred c)` by `(a, c)` and `(pred a, pred c)`. */
+        two_opt_pred = 1,
+        /** Or-opt moving `a` between `c` and `succ c`. */
+        or_opt_succ = 2,
+        /** Or-opt moving `a` between `c` and `pred c`. */
+        or_opt_pred = 3,
+    };
+    static constexpr size_t KINDS = 4;
+
+    utils::pair<std::array<std::vector<double>, KINDS>> values;
+
+    [[gnu::hot]]
+    void resize(size_t count) {
+        for (auto& space : this->values) {
+            for (auto& deltas : space) {
+                deltas.resize(count);
+            }
+        }
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline double operator()(uint8_t t, kind type, size_t j) const noexcept {
+        return this->values[t][(uint8_t) type][j];
+    }
+};
+
+
+/**
+ * Evaluates 2-opt and Or-opt moves for a vertex against its whole candidate list at once.
+ *
+ * Coordinates are kept as one array per axis and space, so that with AVX2 four candidates are
+ * done per iteration: their positions, successors and predecessors are gathered from the
+ * `cycle` once and shared by both spaces. Without AVX2, the same loop is scalar. Both give
+ * the same deltas as `vertex::point::cost`, since costs are rounded up to integers.
+ */
+struct move_kernel final {
+private:
+    utils::pair<std::vector<double>> xs, ys;
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline double cost(uint8_t t, unsigned u, unsigned v) const noexcept {
+        return std::ceil(std::sqrt(
+            (this->xs[t][u] - this->xs[t][v]) * (this->xs[t][u] - this->xs[t][v])
+            + (this->ys[t][u] - this->ys[t][v]) * (this->ys[t][u] - this->ys[t][v])
+        ));
+    }
+
+    /** Deltas for candidates `from` onwards, one at a time. */
+    [[gnu::hot]]
+    void scalar(const cycle& tour, unsigned a, std::span<const unsigned> candidates, size_t from, move_deltas& out) const noexcept {
+        const unsigned a2 = tour.succ(a), ap = tour.pred(a);
+
+        for (size_t j = from; j < candidates.size(); j++) {
+            const unsigned c = candidates[j];
+            const unsigned c2 = tour.succ(c), cp = tour.pred(c);
+            const bool near = (c == a2 || c == ap || c == a);
+
+            for (uint8_t t = 0; t <= 1; t++) {
+                const double ac = this->cost(t, a, c);
+                const double removed = this->cost(t, ap, a) + this->cost(t, a, a2) - this->cost(t, ap, a2);
+                auto& values = out.values[t];
+
+                values[0][j] = near ? INFINITY : ac + this->cost(t, a2, c2) - this->cost(t, a, a2) - this->cost(t, c, c2);
+                values[1][j] = near ? INFINITY : ac + this->cost(t, ap, cp) - this->cost(t, a, ap) - this->cost(t, c, cp);
+                values[2][j] = (near || c2 == a) ? INFINITY : ac + this->cost(t, a, c2) - this->cost(t, c, c2) - removed;
+                values[3][j] = (near || cp == a) ? INFINITY : ac + this->cost(t, a, cp) - this->cost(t, c, cp) - removed;
+            }
+        }
+    }
+
+#if defined(__AVX2__)
+    [[gnu::hot]] [[gnu::always_inline]]
+    static inline __m256d distance(__m256d x1, __m256d y1, __m256d x2, __m256d y2) noexcept {
+        const __m256d dx = _mm256_sub_pd(x1, x2);
+        const __m256d dy = _mm256_sub_pd(y1, y2);
+        return _mm256_ceil_pd(_mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy))));
+    }
+
+    /** Four coordinates at `idx`; the masked gather, since GCC warns about the source of the plain one. */
+    [[gnu::hot]] [[gnu::always_inline]]
+    static inline __m256d gather(const double *base, __m128i idx) noexcept {
+        return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), base, idx, _mm256_castsi256_pd(_mm256_set1_epi64x(-1)), 8);
+    }
+
+    /** Deltas for groups of four candidates, returning how many were done. */
+    [[gnu::hot]]
+    size_t packed(const cycle& tour, unsigned a, std::span<const unsigned> candidates, move_deltas& out) const noexcept {
+        const auto order = reinterpret_cast<const int *>(tour.sequence().data());
+        const auto pos = reinterpret_cast<const int *>(tour.positions().data());
+        const unsigned a2 = tour.succ(a), ap = tour.pred(a);
+
+        const __m128i last = _mm_set1_epi32((int) tour.size() - 1);
+        const __m128i one = _mm_set1_epi32(1);
+        const __m128i va = _mm_set1_epi32((int) a), va2 = _mm_set1_epi32((int) a2), vap = _mm_set1_epi32((int) ap);
+        const __m256d inf = _mm256_set1_pd(INFINITY);
+
+        size_t j = 0;
+        for (; j + 4 <= candidates.size(); j += 4) {
+            const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(candidates.data() + j));
+            const __m128i pc = _mm_i32gather_epi32(pos, c, 4);
+            // wrap around both ends of the array
+            const __m128i next = _mm_andnot_si128(_mm_cmpeq_epi32(pc, last), _mm_add_epi32(pc, one));
+            const __m128i prev = _mm_blendv_epi8(_mm_sub_epi32(pc, one), last, _mm_cmpeq_epi32(pc, _mm_setzero_si128()));
+            const __m128i c2 = _mm_i32gather_epi32(order, next, 4);
+            const __m128i cp = _mm_i32gather_epi32(order, prev, 4);
+
+            const __m128i near = _mm_or_si128(_mm_cmpeq_epi32(c, va), _mm_or_si128(_mm_cmpeq_epi32(c, va2), _mm_cmpeq_epi32(c, vap)));
+            const __m256d skip = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(near));
+            const __m256d skip_succ = _mm256_or_pd(skip, _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm_cmpeq_epi32(c2, va))));
+            const __m256d skip_pred = _mm256_or_pd(skip, _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm_cmpeq_epi32(cp, va))));
+
+            for (uint8_t t = 0; t <= 1; t++) {
+                const double *x = this->xs[t].data(), *y = this->ys[t].data();
+                const __m256d xa = _mm256_set1_pd(x[a]), ya = _mm256_set1_pd(y[a]);
+                const __m256d xa2 = _mm256_set1_pd(x[a2]), ya2 = _mm256_set1_pd(y[a2]);
+                const __m256d xap = _mm256_set1_pd(x[ap]), yap = _mm256_set1_pd(y[ap]);
+                const __m256d xc = gather(x, c), yc = gather(y, c);
+                const __m256d xc2 = gather(x, c2), yc2 = gather(y, c2);
+                const __m256d xcp = gather(x, cp), ycp = gather(y, cp);
+
+                const double a_a2 = this->cost(t, a, a2), a_ap = this->cost(t, a, ap);
+                const __m256d removed = _mm256_set1_pd(a_ap + a_a2 - this->cost(t, ap, a2));
+                const __m256d ac = distance(xa, ya, xc, yc);
+                const __m256d c_c2 = distance(xc, yc, xc2, yc2);
+                const __m256d c_cp = distance(xc, yc, xcp, ycp);
+
+                auto& values = out.values[t];
+                const __m256d succ = _mm256_sub_pd(_mm256_add_pd(ac, distance(xa2, ya2, xc2, yc2)), _mm256_add_pd(_mm256_set1_pd(a_a2), c_c2));
+                const __m256d pred = _mm256_sub_pd(_mm256_add_pd(ac, distance(xap, yap, xcp, ycp)), _mm256_add_pd(_mm256_set1_pd(a_ap), c_cp));
+                const __m256d or_succ = _mm256_sub_pd(_mm256_add_pd(ac, distance(xa, ya, xc2, yc2)), _mm256_add_pd(c_c2, removed));
+                const __m256d or_pred = _mm256_sub_pd(_mm256_add_pd(ac, distance(xa, ya, xcp, ycp)), _mm256_add_pd(c_cp, removed));
+
+                _mm256_storeu_pd(values[0].data() + j, _mm256_blendv_pd(succ, inf, skip));
+                _mm256_storeu_pd(values[1].data() + j, _mm256_blendv_pd(pred, inf, skip));
+                _mm256_storeu_pd(values[2].data() + j, _mm256_blendv_pd(or_succ, inf, skip_succ));
+                _mm256_storeu_pd(values[3].data() + j, _mm256_blendv_pd(or_pred, inf, skip_pred));
+            }
+        }
+        return j;
+    }
+#endif
+
+public:
+    /** Whether `evaluate` uses AVX2. */
+#if defined(__AVX2__)
+    static constexpr bool VECTORIZED = true;
+#else
+    static constexpr bool VECTORIZED = false;
+#endif
+
+    [[gnu::cold]]
+    explicit move_kernel(std::span<const vertex> vertices) {
+        for (uint8_t t = 0; t <= 1; t++) {
+            this->xs[t].reserve(vertices.size());
+            this->ys[t].reserve(vertices.size());
+            for (const auto& v : vertices) {
+                this->xs[t].push_back(v[t].x());
+                this->ys[t].push_back(v[t].y());
+            }
+        }
+    }
+
+    /** Fills `out` with the deltas of every move of `a` against each candidate, on `tour`. */
+    [[gnu::hot]]
+    void evaluate(const cycle& tour, unsigned a, std::span<const unsigned> candidates, move_deltas& out) const {
+        out.resize(candidates.size());
+        size_t done = 0;
+#if defined(__AVX2__)
+        done = this->packed(tour, a, candidates, out);
+#endif
+        this->scalar(tour, a, candidates, done, out);
+    }
+
+    /** Same as `evaluate`, without SIMD, for comparison. */
+    [[gnu::hot]]
+    void evaluate_scalar(const cycle& tour, unsigned a, std::span<const unsigned> candidates, move_deltas& out) const {
+        out.resize(candidates.size());
+        this->scalar(tour, a, candidates, 0, out);
+    }
+};
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "vertex.hpp"
+
+
+/**
+ * Candidate lists: the `width` nearest vertices of each vertex in one cost space.
+ *
+ * Built with a uniform grid over the points, so that large instances do not need all the
+ * `n^2` distances.
+ */
+struct neighbours final {
+private:
+    std::vector<unsigned> items;
+
+public:
+    const size_t width;
+
+    [[gnu::hot]]
+    neighbours(uint8_t i, std::span<const vertex> vertices, size_t width):
+        width(std::min(width, vertices.size() - std::min<size_t>(vertices.size(), 1)))
+    {
+        const size_t n = vertices.size();
+        this->items.reserve(n * this->width);
+        if (this->width == 0) [[unlikely]] {
+            return;
+        }
+
+        double xmin = vertices[0][i].x(), xmax = xmin;
+        double ymin = vertices[0][i].y(), ymax = ymin;
+        for (const auto& v : vertices) {
+            xmin = std::min(xmin, v[i].x());
+            xmax = std::max(xmax, v[i].x());
+            ymin = std::min(ymin, v[i].y());
+            ymax = std::max(ymax, v[i].y());
+        }
+
+        // about two points per cell
+        const size_t side = std::max<size_t>(1, (size_t) std::sqrt(n / 2.0));
+        const double cw = std::max(xmax - xmin, 1e-9) / side;
+        const double ch = std::max(ymax - ymin, 1e-9) / side;
+        const auto cell_of = [&](const vertex::point& p) {
+            const auto cx = std::min(side - 1, (size_t) ((p.x() - xmin) / cw));
+            const auto cy = std::min(side - 1, (size_t) ((p.y() - ymin) / ch));
+            return std::pair(cx, cy);
+        };
+
+        auto start = std::vector<unsigned>(side * side + 1, 0);
+        for (const auto& v : vertices) {
+            const auto [cx, cy] = cell_of(v[i]);
+            start[cy * side + cx + 1]++;
+        }
+        for (size_t c = 0; c < side * side; c++) {
+            start[c + 1] += start[c];
+        }
+        auto cells = std::vector<unsigned>(n);
+        auto fill = std::vector<unsigned>(start.begin(), start.end() - 1);
+        for (unsigned v = 0; v < n; v++) {
+            const auto [cx, cy] = cell_of(vertices[v][i]);
+            cells[fill[cy * side + cx]++] = v;
+        }
+
+        auto found = std::vector<std::pair<double, unsigned>>();
+        for (unsigned u = 0; u < n; u++) {
+            const auto& p = vertices[u][i];
+            const auto [cx, cy] = cell_of(p);
+            found.clear();
+
+            for (size_t ring = 0; ring <= side; ring++) {
+                const auto x0 = (long) cx - (long) ring, x1 = (long) cx + (long) ring;
+                const auto y0 = (long) cy - (long) ring, y1 = (long) cy + (long) ring;
+
+                for (long y = y0; y <= y1; y++) {
+                    for (long x = x0; x <= x1; x++) {
+                        const bool border = (y == y0 || y == y1 || x == x0 || x == x1);
+                        if (!border || x < 0 || y < 0 || x >= (long) side || y >= (long) side) {
+                            continue;
+                        }
+                        const size_t c = y * side + x;
+                        for (unsigned idx = start[c]; idx < start[c + 1]; idx++) {
+                            const unsigned v = cells[idx];
+                            if (v != u) [[likely]] {
+                                const auto& q = vertices[v][i];
+                                found.emplace_back(std::hypot(p.x() - q.x(), p.y() - q.y()), v);
+                            }
+                        }
+                    }
+                }
+
+                // every point farther than this ring was already seen
+                const double reach = ring * std::min(cw, ch);
+                if (found.size() >= this->width) {
+                    std::nth_element(found.begin(), found.begin() + this->width - 1, found.end());
+                    if (found[this->width - 1].first <= reach) {
+                        break;
+                    }
+                }
+            }
+
+            std::partial_sort(found.begin(), found.begin() + this->width, found.end());
+            for (size_t k = 0; k < this->width; k++) {
+                this->items.push_back(found[k].second);
+            }
+        }
+    }
+
+    /** Nearest vertices of `u`, closest first. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline std::span<const unsigned> operator[](unsigned u) const noexcept {
+        return std::span<const unsigned>(this->items.data() + u * this->width, this->width);
+    }
+};
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "graph.hpp"
+#include "interrupts.hpp"
+#include "memory.hpp"
+#include "termination.hpp"
+#include "tour.hpp"
+
+
+/** A solution on the trade-off between the costs of both tours. */
+struct pareto_point final {
+    const char *method;
+    utils::pair<double> weights;
+    utils::pair<double> costs;
+    /** Solve time for this point alone, in seconds. */
+    double secs;
+    termination::reason stop;
+    utils::pair<tour> tours;
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline double weighted(utils::pair<double> w) const noexcept {
+        return w[0] * this->costs[0] + w[1] * this->costs[1];
+    }
+
+    [[gnu::cold]]
+    static inline std::ostream& header(std::ostream& os) {
+        return os << "method,w1,w2,cost1,cost2,secs,stop";
+    }
+
+    [[gnu::cold]]
+    friend inline std::ostream& operator<<(std::ostream& os, const pareto_point& p) {
+        return os << p.method << ',' << p.weights[0] << ',' << p.weights[1] << ','
+            << p.costs[0] << ',' << p.costs[1] << ',' << p.secs << ',' << p.stop;
+    }
+};
+
+
+/**
+ * Enumerates the supported Pareto frontier of (cost of tour 1, cost of tour 2) for a fixed `k`.
+ *
+ * The same model is solved repeatedly, changing only objective coefficients (and the right-hand
+ * side of a cost bound, for epsilon-constraint points), with subtour cuts found so far kept as
+ * lazy constraints and the closest known point as MIP start. A solve stopped before its first
+ * incumbent ends the search, keeping the points found so far.
+ */
+struct pareto final {
+private:
+    graph& g;
+    const termination::criteria criteria;
+    memory_guard& guard;
+    std::vector<pareto_point> found;
+
+    /** Solves for one point, or nothing if the search stopped before any incumbent. */
+    [[gnu::cold]]
+    std::optional<pareto_point> solve(const char *method, utils::pair<double> weights, const pareto_point *warm) {
+        this->g.set_weights(weights);
+        this->g.keep_cuts();
+        if (warm != nullptr) {
+            this->g.set_start(warm->tours);
+        }
+
+        auto control = termination(this->criteria);
+        const auto start = std::chrono::steady_clock::now();
+        try {
+            this->g.solve(control, this->guard);
+        } catch (const utils::invalid_solution&) {
+            // e.g. a stall, node limit or SIGINT before the first incumbent: the points so far still count
+            return std::nullopt;
+        }
+        const std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+
+        auto tours = utils::pair<tour> { this->g.tour(0), this->g.tour(1) };
+        const auto costs = utils::pair<double> {
+            tours[0].cost(0, this->g.vertices),
+            tours[1].cost(1, this->g.vertices),
+        };
+        auto point = pareto_point { method, weights, costs, secs.count(), control.why(), std::move(tours) };
+        this->found.push_back(point);
+        return point;
+    }
+
+public:
+    /** Weight given to the secondary cost on the extreme points, to avoid dominated solutions. */
+    static constexpr double DELTA = 1e-4;
+
+    [[gnu::cold]]
+    pareto(graph& g, termination::criteria criteria, memory_guard& guard):
+        g(g), criteria(criteria), guard(guard)
+    { }
+
+    /** Every point solved so far, in the order they were found. */
+    [[gnu::pure]] [[gnu::cold]]
+    inline const std::vector<pareto_point>& points() const noexcept {
+        return this->found;
+    }
+
+    /**
+     * Dichotomic search over weighted sums, solving at most `limit` models.
+     *
+     * Starts from both extremes, then for each pair of adjacent points uses the weights normal
+     * to the segment between them, keeping the new point if it is below that segment.
+     */
+    [[gnu::cold]]
+    std::vector<pareto_point> supported(size_t limit) {
+        auto frontier = std::vector<pareto_point>();
+        if (limit < 1) [[unlikely]] {
+            return frontier;
+        }
+        auto first = this->solve("weighted", { 1., DELTA }, nullptr);
+        if (!first) [[unlikely]] {
+            return frontier;
+        }
+        frontier.push_back(std::move(*first));
+        if (limit < 2 || interrupts::stop) [[unlikely]] {
+            return frontier;
+        }
+        auto second = this->solve("weighted", { DELTA, 1. }, &frontier[0]);
+        if (!second) [[unlikely]] {
+            return frontier;
+        }
+        frontier.push_back(std::move(*second));
+
+        auto pending = std::vector<std::pair<pareto_point, pareto_point>> { { frontier[0], frontier[1] } };
+        size_t solved = 2;
+
+        while (!pending.empty() && solved < limit && !interrupts::stop) {
+            const auto [left, right] = pending.back();
+            pending.pop_back();
+
+            const double w1 = left.costs[1] - right.costs[1];
+            const double w2 = right.costs[0] - left.costs[0];
+            if (w1 <= 0 || w2 <= 0) {
+                continue;
+            }
+            const double norm = w1 + w2;
+            const auto weights = utils::pair<double> { w1 / norm, w2 / norm };
+
+            const auto& warm = (left.weighted(weights) <= right.weighted(weights)) ? left : right;
+            auto point = this->solve("weighted", weights, &warm);
+            solved++;
+            if (!point) [[unlikely]] {
+                break;
+            }
+
+            if (point->weighted(weights) < left.weighted(weights) - 1e-6) {
+                frontier.push_back(*point);
+                pending.emplace_back(*point, right);
+                pending.emplace_back(left, *point);
+            }
+        }
+
+        std::sort(frontier.begin(), frontier.end(), [](const auto& a, const auto& b) {
+            return a.costs[0] < b.costs[0];
+        });
+        return frontier;
+    }
+
+    /**
+     * Epsilon-constraint points: minimizes the first cost with the second one bounded by `count`
+     * values evenly spaced between both extremes of `frontier`.
+     */
+    [[gnu::cold]]
+    std::vector<pareto_point> epsilon(const std::vector<pareto_point>& frontier, size_t count) {
+        auto points = std::vector<pareto_point>();
+        if (frontier.size() < 2 || count < 1) [[unlikely]] {
+            return points;
+        }
+
+        const double high = frontier.front().costs[1];
+        const double low = frontier.back().costs[1];
+        for (size_t step = 1; step <= count && !interrupts::stop; step++) {
+            const double eps = high - (high - low) * step / (count + 1);
+
+            const pareto_point *warm = nullptr;
+            for (const auto& point : frontier) {
+                if (point.costs[1] <= eps && (warm == nullptr || point.costs[0] < warm->costs[0])) {
+                    warm = &point;
+                }
+            }
+
+            this->g.limit_cost(1, eps);
+            auto point = this->solve("epsilon", { 1., DELTA }, warm);
+            if (!point) [[unlikely]] {
+                break;
+            }
+            points.push_back(std::move(*point));
+        }
+        this->g.limit_cost(1, std::nullopt);
+        return points;
+    }
+};
@@ -0,0 +1,587 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <optional>
+#include <set>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <gurobi_c++.h>
+#include "cuts.hpp"
+#include "elimination.hpp"
+#include "graph.hpp"
+#include "memory.hpp"
+#include "mincut.hpp"
+#include "termination.hpp"
+#include "tour.hpp"
+#include "vertex.hpp"
+
+
+/** How the shared edges between both tours are counted. */
+enum class coupling : uint8_t {
+    /** Product of both edge variables, on the default model. */
+    quadratic,
+    /** One linear variable per edge, below both edge variables. */
+    edges,
+    /** Shared paths as columns, generated from the LP duals. */
+    paths,
+};
+
+[[gnu::cold]]
+static inline coupling parse_coupling(const std::string& name) {
+    if (name == "quadratic") {
+        return coupling::quadratic;
+    } else if (name == "edges") {
+        return coupling::edges;
+    } else if (name == "paths") {
+        return coupling::paths;
+    }
+    throw std::invalid_argument("unknown coupling '" + name + "', expected 'quadratic', 'edges' or 'paths'");
+}
+
+[[gnu::cold]]
+static inline std::ostream& operator<<(std::ostream& os, coupling form) {
+    switch (form) {
+        case coupling::quadratic:
+            return os << "quadratic";
+        case coupling::edges:
+            return os << "edges";
+        case coupling::paths:
+            return os << "paths";
+    }
+    return os << "unknown";
+}
+
+
+/**
+ * Linear model of the kSTSP where shared edges are counted by coupling variables below the edge
+ * variables of both tours, solved as price-and-branch.
+ *
+ * Shared edges form vertex-disjoint paths (unless both tours are equal), so with `coupling::paths`
+ * each column is a simple path, limited to one path per vertex, and columns are generated at the
+ * root by an elementary shortest path over the duals. With `coupling::edges`, every edge is its
+ * own column. The root LP also separates subtour cuts on fractional points with minimum cuts;
+ * the integer phase keeps the generated columns and cuts and uses the usual callback.
+ */
+struct coupled_model final {
+public:
+    /** Root LP result. */
+    struct root_bound final {
+        double bound;
+        double secs;
+        unsigned rounds;
+        size_t cuts;
+        size_t columns;
+        /** Whether pricing proved that no column was missing, making the bound valid. */
+        bool exact;
+        /** Seconds spent separating subtour cuts. */
+        double separation = 0.0;
+        /** Average vertices given to the minimum cut, before and after shrinking. */
+        double support = 0.0;
+        double shrunk = 0.0;
+    };
+
+private:
+    GRBModel model;
+    utils::pair<utils::matrix<GRBConstr>> couple;
+    std::vector<GRBConstr> pack;
+    std::optional<GRBConstr> similar;
+    std::optional<GRBVar> slack;
+    std::vector<GRBVar> columns;
+    std::set<std::vector<unsigned>> known;
+    size_t separated = 0;
+    double separation_secs = 0.0;
+    size_t min_cuts = 0, support_nodes = 0, shrunk_nodes = 0;
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline double cost(uint8_t i, unsigned u, unsigned v) const noexcept {
+        return this->vertices[u][i].cost(this->vertices[v][i]);
+    }
+
+    [[gnu::cold]]
+    inline utils::matrix<GRBVar> add_vars(uint8_t i) {
+        auto vars = utils::matrix<GRBVar>(this->order());
+        for (unsigned u = 0; u < this->order(); u++) {
+            for (unsigned v = u + 1; v < this->order(); v++) {
+                auto var = this->model.addVar(0., 1., this->cost(i, u, v), GRB_CONTINUOUS);
+                vars[u][v] = var;
+                vars[v][u] = var;
+            }
+        }
+        return vars;
+    }
+
+    [[gnu::cold]]
+    inline void add_constraint_deg_2(uint8_t i) {
+        for (unsigned u = 0; u < this->order(); u++) {
+            auto expr = GRBLinExpr();
+            for (unsigned v = 0; v < this->order(); v++) {
+                if (u != v) [[likely]] {
+                    expr += this->vars[i][u][v];
+                }
+            }
+            this->model.addConstr(expr, GRB_EQUAL, 2.);
+        }
+    }
+
+    /** Coupling rows `columns(u, v) - x_i(u, v) <= 0`, one per edge and tour. */
+    [[gnu::cold]]
+    inline void add_coupling() {
+        const unsigned n = (unsigned) this->order();
+        if (this->k >= n) {
+            // the shared edges form a whole cycle: both tours are equal
+            for (unsigned u = 0; u < n; u++) {
+                for (unsigned v = u + 1; v < n; v++) {
+                    this->model.addConstr(this->vars[0][u][v] == this->vars[1][u][v]);
+                }
+            }
+            return;
+        }
+
+        double most = 0.0;
+        for (uint8_t i = 0; i <= 1; i++) {
+            for (unsigned u = 0; u < n; u++) {
+                for (unsigned v = u + 1; v < n; v++) {
+                    most = std::max(most, this->cost(i, u, v));
+                    this->couple[i][u][v] = this->model.addConstr(-this->vars[i][u][v], GRB_LESS_EQUAL, 0.);
+                }
+            }
+        }
+        // a missing shared edge costs more than any change on the tours
+        this->slack = this->model.addVar(0., GRB_INFINITY, 2 * n * most + 1, GRB_CONTINUOUS);
+        this->similar = this->model.addConstr(GRBLinExpr(*this->slack), GRB_GREATER_EQUAL, this->k);
+
+        if (this->mode == coupling::paths) {
+            for (unsigned v = 0; v < n; v++) {
+                this->pack.push_back(this->model.addConstr(GRBLinExpr(), GRB_LESS_EQUAL, 1.));
+            }
+        } else {
+            for (unsigned u = 0; u < n; u++) {
+                for (unsigned v = u + 1; v < n; v++) {
+                    this->add_column({ u, v });
+                }
+            }
+        }
+    }
+
+    /** Adds the path through `path` as a column, unless already present. */
+    [[gnu::cold]]
+    bool add_column(std::vector<unsigned> path) {
+        if (path.front() > path.back()) {
+            std::reverse(path.begin(), path.end());
+        }
+        if (!this->known.insert(path).second) [[unlikely]] {
+            return false;
+        }
+
+        auto constrs = std::vector<GRBConstr>();
+        auto coeffs = std::vector<double>();
+        for (size_t e = 0; e + 1 < path.size(); e++) {
+            const unsigned u = std::min(path[e], path[e + 1]), v = std::max(path[e], path[e + 1]);
+            for (uint8_t i = 0; i <= 1; i++) {
+                constrs.push_back(this->couple[i][u][v]);
+                coeffs.push_back(1.);
+            }
+        }
+        if (this->mode == coupling::paths) {
+            for (unsigned v : path) {
+                constrs.push_back(this->pack[v]);
+                coeffs.push_back(1.);
+            }
+        }
+        constrs.push_back(*this->similar);
+        coeffs.push_back((double) (path.size() - 1));
+
+        const char type = this->integral ? GRB_BINARY : GRB_CONTINUOUS;
+        this->columns.push_back(this->model.addVar(0., 1., 0., type, (int) constrs.size(), constrs.data(), coeffs.data()));
+        return true;
+    }
+
+    /** Adds `x_i(E(S)) <= |S| - 1` for the subtour set `S`. */
+    [[gnu::cold]]
+    void add_subtour_cut(uint8_t i, const std::vector<unsigned>& set) {
+        auto expr = GRBLinExpr();
+        for (unsigned u = 0; u < set.size(); u++) {
+            for (unsigned v = u + 1; v < set.size(); v++) {
+                expr += this->vars[i][set[u]][set[v]];
+            }
+        }
+        this->model.addConstr(expr, GRB_LESS_EQUAL, set.size() - 1);
+
+        auto subtour = ::tour();
+        subtour.assign(set.begin(), set.end());
+        this->cuts.add(i, subtour);
+        this->separated++;
+    }
+
+    /**
+     * Separates subtour cuts on the current LP point, by components or by a minimum cut. The
+     * LP satisfies the degree rows, so the support graph can be shrunk first.
+     */
+    [[gnu::hot]]
+    size_t separate() {
+        const auto start = std::chrono::steady_clock::now();
+        size_t added = 0;
+        for (uint8_t i = 0; i <= 1; i++) {
+            auto weights = utils::matrix<double>(this->order());
+            for (unsigned u = 0; u < this->order(); u++) {
+                weights[u][u] = 0.0;
+                for (unsigned v = u + 1; v < this->order(); v++) {
+                    const double value = this->vars[i][u][v].get(GRB_DoubleAttr_X);
+                    weights[u][v] = value;
+                    weights[v][u] = value;
+                }
+            }
+
+            const auto parts = min_cut::components(weights);
+            if (parts.size() > 1) {
+                for (const auto& part : parts) {
+                    auto set = part;
+                    std::sort(set.begin(), set.end());
+                    this->add_subtour_cut(i, set);
+                    added++;
+                }
+                continue;
+            }
+
+            this->min_cuts++;
+            this->support_nodes += this->order();
+            auto cut = min_cut { INFINITY, {} };
+            if (this->shrinking) {
+                auto graph = shrunk_graph::padberg_rinaldi(weights, EPSILON);
+                this->shrunk_nodes += graph.size();
+                cut = min_cut::stoer_wagner(std::move(graph));
+            } else {
+                this->shrunk_nodes += this->order();
+                cut = min_cut::stoer_wagner(std::move(weights));
+            }
+            if (cut.value < 2.0 - EPSILON && cut.side.size() > 1) {
+                this->add_subtour_cut(i, cut.side);
+                added++;
+            }
+        }
+        const std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+        this->separation_secs += secs.count();
+        return added;
+    }
+
+    struct label final {
+        unsigned end;
+        unsigned length;
+        double cost;
+        size_t parent;
+        std::vector<uint64_t> visited;
+        bool dominated = false;
+
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline bool has(unsigned v) const noexcept {
+            return (this->visited[v / 64] >> (v % 64)) & 1;
+        }
+
+        /** Same end vertex, no more expensive, and no more visited vertices. */
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline bool dominates(const label& other) const noexcept {
+            if (this->cost > other.cost + 1e-9) {
+                return false;
+            }
+            for (size_t w = 0; w < this->visited.size(); w++) {
+                if ((this->visited[w] & ~other.visited[w]) != 0) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+
+    /**
+     * Elementary shortest paths on the reduced costs, by labeling with dominance, returning the
+     * most negative paths found. Stops early after `MAX_LABELS` labels, when it is only a
+     * heuristic; `exact` tells which case happened.
+     */
+    [[gnu::hot]]
+    std::vector<std::pair<double, std::vector<unsigned>>> price(bool& exact) {
+        const unsigned n = (unsigned) this->order();
+        const double mu = this->similar->get(GRB_DoubleAttr_Pi);
+
+        auto edge = utils::matrix<double>(n);
+        auto node = std::vector<double>(n);
+        double cheapest = 0.0;
+        for (unsigned u = 0; u < n; u++) {
+            node[u] = -this->pack[u].get(GRB_DoubleAttr_Pi);
+            edge[u][u] = INFINITY;
+        }
+        for (unsigned u = 0; u < n; u++) {
+            for (unsigned v = u + 1; v < n; v++) {
+                const double pi = this->couple[0][u][v].get(GRB_DoubleAttr_Pi) + this->couple[1][u][v].get(GRB_DoubleAttr_Pi);
+                edge[u][v] = edge[v][u] = -pi - mu;
+                cheapest = std::min(cheapest, edge[u][v] + std::min(node[u], node[v]));
+            }
+        }
+
+        auto labels = std::vector<label>();
+        auto at = std::vector<std::vector<size_t>>(n);
+        auto queue = std::deque<size_t>();
+        const size_t words = (n + 63) / 64;
+
+        for (unsigned u = 0; u < n; u++) {
+            auto start = label { u, 1, node[u], SIZE_MAX, std::vector<uint64_t>(words, 0), false };
+            start.visited[u / 64] |= uint64_t(1) << (u % 64);
+            at[u].push_back(labels.size());
+            queue.push_back(labels.size());
+            labels.push_back(std::move(start));
+        }
+
+        auto found = std::vector<std::pair<double, size_t>>();
+        exact = true;
+        while (!queue.empty()) {
+            if (labels.size() >= MAX_LABELS) [[unlikely]] {
+                exact = false;
+                break;
+            }
+            const size_t idx = queue.front();
+            queue.pop_front();
+            if (labels[idx].dominated) {
+                continue;
+            }
+
+            // every extension gains at most `cheapest` per vertex
+            const double reach = labels[idx].cost + (n - labels[idx].length) * cheapest;
+            if (reach >= -EPSILON) {
+                continue;
+            }
+
+            for (unsigned v = 0; v < n; v++) {
+                const auto& from = labels[idx];
+                if (from.has(v)) {
+                    continue;
+                }
+                auto next = label { v, from.length + 1, from.cost + edge[from.end][v] + node[v], idx, from.visited, false };
+                next.visited[v / 64] |= uint64_t(1) << (v % 64);
+
+                bool dominated = false;
+                for (size_t other : at[v]) {
+                    if (labels[other].dominates(next)) {
+                        dominated = true;
+                        break;
+                    }
+                }
+                if (dominated) {
+                    continue;
+                }
+                std::erase_if(at[v], [&](size_t other) {
+                    if (next.dominates(labels[other])) {
+                        labels[other].dominated = true;
+                        return true;
+                    }
+                    return false;
+                });
+
+                if (next.cost < -EPSILON) {
+                    found.emplace_back(next.cost, labels.size());
+                }
+                at[v].push_back(labels.size());
+                queue.push_back(labels.size());
+                labels.push_back(std::move(next));
+            }
+        }
+
+        std::sort(found.begin(), found.end());
+        auto paths = std::vector<std::pair<double, std::vector<unsigned>>>();
+        for (const auto& [rc, idx] : found) {
+            if (paths.size() >= MAX_COLUMNS) {
+                break;
+            }
+            auto path = std::vector<unsigned>();
+            for (size_t cur = idx; cur != SIZE_MAX; cur = labels[cur].parent) {
+                path.push_back(labels[cur].end);
+            }
+            paths.emplace_back(rc, std::move(path));
+        }
+        return paths;
+    }
+
+public:
+    static constexpr double EPSILON = 1e-6;
+    /** Columns added per pricing round. */
+    static constexpr size_t MAX_COLUMNS = 64;
+    /** Labels created per pricing round before giving up on exact pricing. */
+    static constexpr size_t MAX_LABELS = 200000;
+
+    [[gnu::cold]]
+    coupled_model(std::span<const vertex> vertices, const GRBEnv& env, unsigned k, coupling mode):
+        model(env),
+        couple({ utils::matrix<GRBConstr>(vertices.size()), utils::matrix<GRBConstr>(vertices.size()) }),
+        vertices(vertices), vars({ this->add_vars(0), this->add_vars(1) }), k(k), mode(mode)
+    {
+        if (mode == coupling::quadratic) [[unlikely]] {
+            throw std::invalid_argument("the quadratic coupling uses the default model");
+        }
+        this->add_constraint_deg_2(0);
+        this->add_constraint_deg_2(1);
+        if (k > 0) {
+            this->add_coupling();
+        }
+        this->model.update();
+    }
+
+    const std::span<const vertex> vertices;
+    const utils::pair<utils::matrix<GRBVar>> vars;
+    /** Minimum number of shared edges. */
+    const unsigned k;
+    const coupling mode;
+    /** Subtour sets separated at the root and in the integer phase. */
+    cut_pool cuts;
+    /** Whether variables are already binary. */
+    bool integral = false;
+    /** Shrink the support graph by the Padberg-Rinaldi rule before each minimum cut. */
+    bool shrinking = true;
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline size_t order() const noexcept {
+        return this->vertices.size();
+    }
+
+    /** Coupling variables, either generated paths or one per edge. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline size_t column_count() const noexcept {
+        return this->columns.size();
+    }
+
+    /** Stops the running LP or MIP as soon as possible; safe to call from another thread. */
+    [[gnu::cold]]
+    void terminate() {
+        this->model.terminate();
+    }
+
+    /** Value of edge `(u, v)` on tour `i` in the last LP or integer solution. */
+    [[gnu::pure]] [[gnu::hot]]
+    inline double value(uint8_t i, unsigned u, unsigned v) const {
+        return (u != v) ? this->vars[i][u][v].get(GRB_DoubleAttr_X) : 0.0;
+    }
+
+    /**
+     * Root LP: alternates separation of subtour cuts on fractional points and pricing of
+     * path columns until neither finds anything, or `seconds` run out. Always ends on a solved
+     * LP, unless it failed.
+     */
+    [[gnu::cold]]
+    root_bound root(std::optional<double> seconds = std::nullopt) {
+        const auto start = std::chrono::steady_clock::now();
+        const auto spent = [&start]() {
+            const std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+            return secs.count();
+        };
+
+        auto result = root_bound { -INFINITY, 0., 0, 0, 0, true };
+        while (true) {
+            this->model.optimize();
+            result.rounds++;
+            if (this->model.get(GRB_IntAttr_Status) != GRB_OPTIMAL) [[unlikely]] {
+                result.exact = false;
+                break;
+            }
+            result.bound = this->model.get(GRB_DoubleAttr_ObjVal);
+            // stop right after solving, so the LP point is still available
+            if (seconds && spent() >= *seconds) [[unlikely]] {
+                result.exact = false;
+                break;
+            }
+
+            if (this->separate() > 0) {
+                continue;
+            }
+            if (this->mode != coupling::paths || !this->similar) {
+                break;
+            }
+
+            bool exact = true;
+            size_t added = 0;
+            for (auto& [_, path] : this->price(exact)) {
+                added += this->add_column(std::move(path)) ? 1 : 0;
+            }
+            if (added == 0) {
+                result.exact = exact;
+                break;
+            }
+        }
+
+        result.secs = spent();
+        result.cuts = this->separated;
+        result.columns = this->columns.size();
+        result.separation = this->separation_secs;
+        if (this->min_cuts > 0) {
+            result.support = (double) this->support_nodes / this->min_cuts;
+            result.shrunk = (double) this->shrunk_nodes / this->min_cuts;
+        }
+        return result;
+    }
+
+    /** Integer phase over the columns and cuts found so far. */
+    [[gnu::hot]]
+    double solve(termination& control, memory_guard& guard) {
+        const auto start = std::chrono::steady_clock::now();
+        if (!this->integral) {
+            for (uint8_t i = 0; i <= 1; i++) {
+                for (unsigned u = 0; u < this->order(); u++) {
+                    for (unsigned v = u + 1; v < this->order(); v++) {
+                        auto var = this->vars[i][u][v];
+                        var.set(GRB_CharAttr_VType, GRB_BINARY);
+                    }
+                }
+            }
+            for (auto& column : this->columns) {
+                column.set(GRB_CharAttr_VType, GRB_BINARY);
+            }
+            if (this->slack) {
+                this->slack->set(GRB_DoubleAttr_UB, 0.);
+            }
+            this->integral = true;
+        }
+        if (auto gigabytes = guard.nodefile_start()) {
+            this->model.set(GRB_DoubleParam_NodefileStart, *gigabytes);
+            this->model.set(GRB_StringParam_NodefileDir, guard.nodefile_dir);
+        }
+
+        auto callback = subtour_elim(this->vertices, this->vars, control, guard, this->cuts);
+        callback.similarity = this->k;
+        this->model.setCallback(&callback);
+
+        control.enter(termination::phase::exact);
+        this->model.optimize();
+        control.stop(solver_status(this->model.get(GRB_IntAttr_Status)));
+
+        if (this->model.get(GRB_IntAttr_SolCount) <= 0) [[unlikely]] {
+            throw utils::invalid_solution::zero_solutions(this->vertices);
+        }
+        const std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+        return secs.count();
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    double solution_cost() const {
+        return this->model.get(GRB_DoubleAttr_ObjVal);
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    double bound() const {
+        return this->model.get(GRB_DoubleAttr_ObjBound);
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    auto tour(uint8_t i) const {
+        auto min = utils::min_sub_tour(this->vertices, [this, i](unsigned u, unsigned v) {
+            return u != v && this->vars[i][u][v].get(GRB_DoubleAttr_X) > 0.5;
+        });
+        if (min.size() != this->order()) [[unlikely]] {
+            throw utils::invalid_solution::incomplete_tour(this->vertices, min);
+        }
+        return min;
+    }
+};
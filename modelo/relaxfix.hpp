@@ -0,0 +1,272 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <gurobi_c++.h>
+#include "graph.hpp"
+#include "mailbox.hpp"
+#include "memory.hpp"
+#include "paths.hpp"
+#include "termination.hpp"
+#include "tour.hpp"
+#include "vertex.hpp"
+
+
+/**
+ * Relax-and-fix primal heuristic, on its own thread and Gurobi environment.
+ *
+ * Solves the LP relaxation with the linear edge coupling and subtour cuts, fixes the edges close
+ * to 1 on each tour (and the ones both tours agree on), then solves the reduced MIP with `graph`
+ * and `subtour_elim`. When that fails, the least certain half of the fixings is released and the
+ * MIP solved again. Thresholds go from aggressive to conservative, so the first incumbents come
+ * fast and later ones improve on them; each one is posted on a `mailbox`.
+ */
+struct relax_and_fix final {
+public:
+    /** An incumbent found by the heuristic. */
+    struct incumbent final {
+        /** Seconds since the heuristic started. */
+        double secs;
+        double cost;
+        double threshold;
+        size_t fixed;
+    };
+
+    /** Fixing thresholds, in the order they are tried. */
+    static constexpr double THRESHOLDS[] = { 0.5, 0.8, 0.95, 0.999 };
+    /** Times the fixings are halved before giving up on a threshold. */
+    static constexpr unsigned MAX_BACKTRACKS = 4;
+    /** Edges with LP values on both tours within this distance are fixed on both. */
+    static constexpr double AGREEMENT = 0.1;
+
+private:
+    std::span<const vertex> vertices;
+    unsigned k;
+    mailbox& outbox;
+    std::optional<double> budget;
+    /** Gurobi threads and seed, as set on the main environment. */
+    unsigned threads;
+    std::optional<int> seed;
+
+    std::atomic<bool> cancelled = false;
+    std::mutex running;
+    graph *current = nullptr;
+    coupled_model *relaxation = nullptr;
+    std::vector<incumbent> found;
+    std::thread worker;
+
+    using clock = std::chrono::steady_clock;
+    using fixing = std::tuple<double, uint8_t, unsigned, unsigned>;
+
+    /**
+     * Edges worth fixing, most certain first. Keeps only edges that still form paths on their
+     * tour: at most two per vertex and no cycle.
+     */
+    [[gnu::cold]]
+    std::vector<fixing> candidates(const coupled_model& lp, double threshold) const {
+        const unsigned n = (unsigned) this->vertices.size();
+        auto all = std::vector<fixing>();
+        for (uint8_t i = 0; i <= 1; i++) {
+            for (unsigned u = 0; u < n; u++) {
+                for (unsigned v = u + 1; v < n; v++) {
+                    const double value = lp.value(i, u, v), other = lp.value(1 - i, u, v);
+                    if (value >= threshold) {
+                        all.emplace_back(value, i, u, v);
+                    } else if (value >= 0.5 && other >= 0.5 && std::abs(value - other) <= AGREEMENT) {
+                        all.emplace_back(std::min(value, other), i, u, v);
+                    }
+                }
+            }
+        }
+        std::sort(all.begin(), all.end(), std::greater<>());
+
+        auto kept = std::vector<fixing>();
+        for (uint8_t i = 0; i <= 1; i++) {
+            auto degree = std::vector<unsigned>(n, 0);
+            auto parent = std::vector<unsigned>(n);
+            std::iota(parent.begin(), parent.end(), 0);
+            const auto root = [&parent](unsigned v) {
+                while (parent[v] != v) {
+                    v = parent[v] = parent[parent[v]];
+                }
+                return v;
+            };
+
+            for (const auto& item : all) {
+                const auto [_, t, u, v] = item;
+                if (t != i || degree[u] >= 2 || degree[v] >= 2 || root(u) == root(v)) {
+                    continue;
+                }
+                degree[u]++;
+                degree[v]++;
+                parent[root(u)] = root(v);
+                kept.push_back(item);
+            }
+        }
+        std::sort(kept.begin(), kept.end(), std::greater<>());
+        return kept;
+    }
+
+    [[gnu::cold]]
+    void run(memory_guard guard) {
+        const auto start = clock::now();
+        const auto elapsed = [&start]() {
+            const std::chrono::duration<double> secs = clock::now() - start;
+            return secs.count();
+        };
+
+        auto env = GRBEnv(true);
+        env.set(GRB_IntParam_OutputFlag, 0);
+        env.set(GRB_IntParam_LazyConstraints, 1);
+        if (this->threads > 0) {
+            env.set(GRB_IntParam_Threads, (int) this->threads);
+        }
+        if (this->seed) {
+            env.set(GRB_IntParam_Seed, *this->seed);
+        }
+        env.start();
+
+        auto lp = coupled_model(this->vertices, env, this->k, coupling::edges);
+        auto g = graph(this->vertices, env, this->k);
+        g.patching = true;
+
+        // models are only visible to `stop()` while alive, even when leaving by an exception
+        struct registration final {
+            relax_and_fix& owner;
+
+            ~registration() {
+                auto lock = std::lock_guard(this->owner.running);
+                this->owner.relaxation = nullptr;
+                this->owner.current = nullptr;
+            }
+        };
+        {
+            auto lock = std::lock_guard(this->running);
+            if (this->cancelled) {
+                return;
+            }
+            this->relaxation = &lp;
+            this->current = &g;
+        }
+        const auto registered = registration { *this };
+
+        const auto root = lp.root(this->budget);
+        if (this->cancelled || !termination::known(root.bound)) [[unlikely]] {
+            return;
+        }
+        // the cuts from the root LP hold for every reduced MIP
+        for (const auto& [key, _] : lp.cuts) {
+            auto subtour = tour();
+            subtour.assign(key.second.begin(), key.second.end());
+            g.cuts.add(key.first, subtour);
+        }
+        g.keep_cuts();
+
+        std::optional<utils::pair<tour>> best;
+        for (const double threshold : THRESHOLDS) {
+            auto fixings = this->candidates(lp, threshold);
+
+            for (unsigned tries = 0; tries <= MAX_BACKTRACKS && !this->cancelled; tries++) {
+                if (this->budget && elapsed() >= *this->budget) {
+                    this->cancelled = true;
+                    break;
+                }
+                g.release_edges();
+                for (const auto& [_, i, u, v] : fixings) {
+                    g.fix_edge(i, u, v);
+                }
+                if (best) {
+                    g.set_start(*best);
+                }
+                g.time_limit(this->budget ? std::optional(std::max(*this->budget - elapsed(), 0.)) : std::nullopt);
+
+                auto control = termination();
+                try {
+                    g.solve(control, guard);
+                } catch (const utils::invalid_solution&) {
+                    if (control.why() == termination::reason::cancelled) [[unlikely]] {
+                        this->cancelled = true;
+                        break;
+                    }
+                    // infeasible with these fixings: release the least certain half
+                    fixings.resize(fixings.size() / 2);
+                    continue;
+                }
+
+                auto tours = utils::pair<tour> { g.tour(0), g.tour(1) };
+                const double cost = g.solution_cost();
+                if (this->outbox.post(tours, cost)) {
+                    this->found.push_back(incumbent { elapsed(), cost, threshold, fixings.size() });
+                    best = std::move(tours);
+                }
+                break;
+            }
+        }
+    }
+
+public:
+    /**
+     * Starts the heuristic, stopping by itself after `budget` seconds, if given. Its models use
+     * `threads` (Gurobi's default when zero) and `seed`, like the main one.
+     */
+    [[gnu::cold]]
+    relax_and_fix(
+        std::span<const vertex> vertices, unsigned k, mailbox& outbox, memory_guard guard, std::optional<double> budget,
+        unsigned threads = 0, std::optional<int> seed = std::nullopt
+    ):
+        vertices(vertices), k(k), outbox(outbox), budget(budget), threads(threads), seed(seed)
+    {
+        this->worker = std::thread([this, guard]() {
+            try {
+                this->run(guard);
+            } catch (const GRBException& err) {
+                std::cerr << "relax-and-fix: GRBException: code " << err.getErrorCode() << ", " << err.getMessage() << std::endl;
+            } catch (const std::exception& err) {
+                std::cerr << "relax-and-fix: " << err.what() << std::endl;
+            }
+        });
+    }
+
+    relax_and_fix(const relax_and_fix&) = delete;
+    relax_and_fix& operator=(const relax_and_fix&) = delete;
+
+    /** Stops the heuristic and waits for its thread. */
+    [[gnu::cold]]
+    void stop() {
+        {
+            auto lock = std::lock_guard(this->running);
+            this->cancelled = true;
+            if (this->relaxation != nullptr) {
+                this->relaxation->terminate();
+            }
+            if (this->current != nullptr) {
+                this->current->terminate();
+            }
+        }
+        if (this->worker.joinable()) {
+            this->worker.join();
+        }
+    }
+
+    [[gnu::cold]]
+    ~relax_and_fix() {
+        this->stop();
+    }
+
+    /** Incumbents posted, in the order found. Only valid after `stop()`. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline const std::vector<incumbent>& incumbents() const noexcept {
+        return this->found;
+    }
+};
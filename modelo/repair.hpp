@@ -0,0 +1,361 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <queue>
+#include <span>
+#include <vector>
+
+#include "cycle.hpp"
+#include "moves.hpp"
+#include "neighbours.hpp"
+#include "tour.hpp"
+#include "vertex.hpp"
+
+
+/**
+ * Raises the number of edges shared by a pair of tours to at least `k`, at minimum cost.
+ *
+ * The greedy phase creates missing edges of one tour in the other, one 2-opt or Or-opt move
+ * at a time, choosing the move with the smallest cost increase per shared edge gained. Then a
+ * local search improves both tours without going below `k` shared edges.
+ */
+struct similarity_repair final {
+private:
+    std::span<const vertex> vertices;
+    utils::pair<cycle> tours;
+    long shared_edges;
+
+    enum class kind : uint8_t {
+        /** 2-opt on the successors of both endpoints. */
+        two_opt_succ,
+        /** 2-opt on the predecessors of both endpoints. */
+        two_opt_pred,
+        /** Or-opt moving `b` next to `a`, on the side of `side`. */
+        or_opt,
+    };
+
+    struct move final {
+        uint8_t t;
+        kind type;
+        unsigned a, b, side;
+        double delta;
+        long gain;
+
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline double score() const noexcept {
+            return this->delta / (double) this->gain;
+        }
+    };
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline double cost(uint8_t t, unsigned u, unsigned v) const noexcept {
+        return this->vertices[u][t].cost(this->vertices[v][t]);
+    }
+
+    /** Whether edge `(u, v)` is present on the tour other than `t`. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline long in_other(uint8_t t, unsigned u, unsigned v) const noexcept {
+        return this->tours[1 - t].adjacent(u, v) ? 1 : 0;
+    }
+
+    /** 2-opt replacing `(a, a2)` and `(b, b2)` by `(a, b)` and `(a2, b2)` on tour `t`. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline move two_opt(uint8_t t, kind type, unsigned a, unsigned a2, unsigned b, unsigned b2) const noexcept {
+        const double delta = this->cost(t, a, b) + this->cost(t, a2, b2) - this->cost(t, a, a2) - this->cost(t, b, b2);
+        const long gain = this->in_other(t, a, b) + this->in_other(t, a2, b2)
+            - this->in_other(t, a, a2) - this->in_other(t, b, b2);
+        return move { t, type, a, b, 0, delta, gain };
+    }
+
+    /** Or-opt moving `b` between `a` and `side` on tour `t`. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline std::optional<move> or_opt(uint8_t t, unsigned b, unsigned a, unsigned side) const noexcept {
+        const auto [p, nx] = this->tours[t].around(b, a, side);
+        if (b == side || p == a || nx == a) [[unlikely]] {
+            return std::nullopt;
+        }
+        const double delta = this->cost(t, a, b) + this->cost(t, b, side) + this->cost(t, p, nx)
+            - this->cost(t, a, side) - this->cost(t, p, b) - this->cost(t, b, nx);
+        const long gain = this->in_other(t, a, b) + this->in_other(t, b, side) + this->in_other(t, p, nx)
+            - this->in_other(t, a, side) - this->in_other(t, p, b) - this->in_other(t, b, nx);
+        return move { t, kind::or_opt, a, b, side, delta, gain };
+    }
+
+    /** Cheapest move creating edge `(a, b)` on tour `t`, per shared edge gained. */
+    [[gnu::pure]] [[gnu::hot]]
+    std::optional<move> best_insertion(uint8_t t, unsigned a, unsigned b) const noexcept {
+        const auto& tour = this->tours[t];
+        if (a == b || tour.adjacent(a, b)) [[unlikely]] {
+            return std::nullopt;
+        }
+
+        std::optional<move> best;
+        const auto consider = [&best](std::optional<move> candidate) {
+            if (candidate && candidate->gain > 0) {
+                if (!best || candidate->score() < best->score()) {
+                    best = candidate;
+                }
+            }
+        };
+
+        consider(this->two_opt(t, kind::two_opt_succ, a, tour.succ(a), b, tour.succ(b)));
+        consider(this->two_opt(t, kind::two_opt_pred, a, tour.pred(a), b, tour.pred(b)));
+        consider(this->or_opt(t, b, a, tour.succ(a)));
+        consider(this->or_opt(t, b, a, tour.pred(a)));
+        consider(this->or_opt(t, a, b, tour.succ(b)));
+        consider(this->or_opt(t, a, b, tour.pred(b)));
+        return best;
+    }
+
+    /** Applies a move, returning the vertices whose edges changed. */
+    [[gnu::hot]]
+    std::vector<unsigned> apply(const move& mv) {
+        auto& tour = this->tours[mv.t];
+        std::vector<unsigned> touched;
+
+        switch (mv.type) {
+            case kind::two_opt_succ:
+            case kind::two_opt_pred: {
+                const bool succ = (mv.type == kind::two_opt_succ);
+                const unsigned a2 = succ ? tour.succ(mv.a) : tour.pred(mv.a);
+                const unsigned b2 = succ ? tour.succ(mv.b) : tour.pred(mv.b);
+                if (!tour.two_opt(mv.a, a2, mv.b, b2)) [[unlikely]] {
+                    return touched;
+                }
+                touched = { mv.a, a2, mv.b, b2 };
+                break;
+            }
+            case kind::or_opt: {
+                const auto [p, nx] = tour.around(mv.b, mv.a, mv.side);
+                if (!tour.or_opt(mv.b, mv.a, mv.side)) [[unlikely]] {
+                    return touched;
+                }
+                touched = { mv.a, mv.b, mv.side, p, nx };
+                break;
+            }
+        }
+        this->shared_edges += mv.gain;
+        return touched;
+    }
+
+    struct entry final {
+        double score;
+        uint8_t t;
+        unsigned a, b;
+
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline bool operator>(const entry& other) const noexcept {
+            return this->score > other.score;
+        }
+    };
+    using heap = std::priority_queue<entry, std::vector<entry>, std::greater<entry>>;
+
+    [[gnu::hot]]
+    inline void push(heap& queue, uint8_t t, unsigned a, unsigned b) const {
+        if (auto mv = this->best_insertion(t, a, b)) {
+            queue.push(entry { mv->score(), t, a, b });
+        }
+    }
+
+public:
+    [[gnu::cold]]
+    similarity_repair(std::span<const vertex> vertices, const utils::pair<tour>& tours):
+        vertices(vertices), tours({ cycle(tours[0]), cycle(tours[1]) }),
+        shared_edges(tour::shared(tours[0], tours[1], vertices.size()))
+    { }
+
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline unsigned shared() const noexcept {
+        return (unsigned) this->shared_edges;
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline double cost() const noexcept {
+        return this->tours[0].cost(0, this->vertices) + this->tours[1].cost(1, this->vertices);
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline utils::pair<tour> result() const {
+        return { this->tours[0].to_tour(), this->tours[1].to_tour() };
+    }
+
+    /**
+     * Greedy phase: inserts edges until at least `k` are shared.
+     *
+     * Falls back to using the cheapest tour for both if the moves run out before `k`.
+     */
+    [[gnu::hot]]
+    unsigned raise(unsigned k) {
+        const unsigned n = (unsigned) this->vertices.size();
+        if (this->shared_edges >= k || n < 3) [[unlikely]] {
+            return this->shared();
+        }
+
+        auto queue = heap();
+        for (uint8_t t = 0; t <= 1; t++) {
+            const auto& other = this->tours[1 - t];
+            for (unsigned u = 0; u < n; u++) {
+                this->push(queue, t, u, other.succ(u));
+            }
+        }
+
+        while (this->shared_edges < k && !queue.empty()) {
+            const auto top = queue.top();
+            queue.pop();
+
+            const auto mv = this->best_insertion(top.t, top.a, top.b);
+            if (!mv) {
+                continue;
+            }
+            if (mv->score() > top.score + 1e-9) {
+                queue.push(entry { mv->score(), top.t, top.a, top.b });
+                continue;
+            }
+
+            for (unsigned v : this->apply(*mv)) {
+                for (uint8_t t = 0; t <= 1; t++) {
+                    const auto& other = this->tours[1 - t];
+                    this->push(queue, t, v, other.succ(v));
+                    this->push(queue, t, v, other.pred(v));
+                }
+            }
+        }
+
+        if (this->shared_edges < k) [[unlikely]] {
+            const double first = this->tours[0].cost(0, this->vertices) + this->tours[0].cost(1, this->vertices);
+            const double second = this->tours[1].cost(0, this->vertices) + this->tours[1].cost(1, this->vertices);
+            const uint8_t keep = (first <= second) ? 0 : 1;
+            this->tours[1 - keep] = this->tours[keep];
+            this->shared_edges = n;
+        }
+        return this->shared();
+    }
+
+    /** Candidate list width for the local search. */
+    static constexpr size_t WIDTH = 8;
+
+    /**
+     * Local search phase: improving 2-opt and Or-opt moves over nearest-neighbour candidates,
+     * keeping at least `k` shared edges.
+     */
+    [[gnu::hot]]
+    void improve(unsigned k) {
+        const unsigned n = (unsigned) this->vertices.size();
+        if (n < 5) [[unlikely]] {
+            return;
+        }
+
+        const auto kernel = move_kernel(this->vertices);
+        auto deltas = move_deltas();
+        for (uint8_t t = 0; t <= 1; t++) {
+            const auto near = neighbours(t, this->vertices, WIDTH);
+            auto& tour = this->tours[t];
+
+            auto queued = std::vector<bool>(n, true);
+            auto queue = std::deque<unsigned>();
+            for (unsigned v = 0; v < n; v++) {
+                queue.push_back(tour.at(v));
+            }
+
+            const auto accept = [&](const std::optional<move>& mv) {
+                if (!mv || mv->delta >= -1e-9 || this->shared_edges + mv->gain < (long) k) {
+                    return false;
+                }
+                for (unsigned v : this->apply(*mv)) {
+                    if (!queued[v]) {
+                        queued[v] = true;
+                        queue.push_back(v);
+                    }
+                }
+                return true;
+            };
+
+            while (!queue.empty()) {
+                const unsigned a = queue.front();
+                queue.pop_front();
+                queued[a] = false;
+
+                // only moves that improve the cost are built, to check the shared edges
+                kernel.evaluate(tour, a, near[a], deltas);
+                const auto improves = [&deltas, t](move_deltas::kind type, size_t j) {
+                    return deltas(t, type, j) < -1e-9;
+                };
+                for (size_t j = 0; j < near[a].size(); j++) {
+                    const unsigned c = near[a][j];
+                    if (tour.adjacent(a, c)) {
+                        continue;
+                    }
+                    if ((improves(move_deltas::kind::two_opt_succ, j) && accept(this->two_opt(t, kind::two_opt_succ, a, tour.succ(a), c, tour.succ(c))))
+                        || (improves(move_deltas::kind::two_opt_pred, j) && accept(this->two_opt(t, kind::two_opt_pred, a, tour.pred(a), c, tour.pred(c))))
+                        || (improves(move_deltas::kind::or_opt_succ, j) && accept(this->or_opt(t, a, c, tour.succ(c))))
+                        || (improves(move_deltas::kind::or_opt_pred, j) && accept(this->or_opt(t, a, c, tour.pred(c)))))
+                    {
+                        if (!queued[a]) {
+                            queued[a] = true;
+                            queue.push_back(a);
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    /** Nearest-neighbour tour in space `i`, starting at vertex 0. */
+    [[gnu::cold]]
+    static tour nearest(uint8_t i, std::span<const vertex> vertices) {
+        const unsigned n = (unsigned) vertices.size();
+        const auto near = neighbours(i, vertices, WIDTH);
+        auto visited = std::vector<bool>(n, false);
+        auto path = tour();
+        path.reserve(n);
+
+        for (unsigned u = 0; n > 0;) {
+            visited[u] = true;
+            path.push_back(u);
+            if (path.size() == n) {
+                break;
+            }
+
+            unsigned next = n;
+            for (unsigned v : near[u]) {
+                if (!visited[v]) {
+                    next = v;
+                    break;
+                }
+            }
+            // all candidates used: fall back to a full scan
+            if (next == n) [[unlikely]] {
+                double best = INFINITY;
+                for (unsigned v = 0; v < n; v++) {
+                    const double cost = vertices[u][i].cost(vertices[v][i]);
+                    if (!visited[v] && cost < best) {
+                        best = cost;
+                        next = v;
+                    }
+                }
+            }
+            u = next;
+        }
+        return path;
+    }
+
+    /** Nearest-neighbour tours in each space, through both phases. */
+    [[gnu::cold]]
+    static utils::pair<tour> construct(std::span<const vertex> vertices, unsigned k) {
+        return run(vertices, { nearest(0, vertices), nearest(1, vertices) }, k);
+    }
+
+    /** Both phases, returning the repaired tours. */
+    [[gnu::hot]]
+    static utils::pair<tour> run(std::span<const vertex> vertices, const utils::pair<tour>& tours, unsigned k) {
+        auto repair = similarity_repair(vertices, tours);
+        repair.raise(k);
+        repair.improve(k);
+        return repair.result();
+    }
+};
@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "generator.hpp"
+#include "mincut.hpp"
+#include "trace.hpp"
+#include "tour.hpp"
+#include "argparse.hpp"
+
+
+/**
+ * Replays a trace written by `modelo --record-trace` through each separation routine, so they
+ * can be compared on the same points without running the solver.
+ */
+struct program final {
+private:
+    argparse::ArgumentParser args;
+
+    /** Separation routine for one tour, returning the number of cuts found. */
+    template <typename Value>
+    struct separator final {
+        std::string name;
+        std::function<size_t(std::span<const vertex>, const utils::matrix<Value>&)> separate;
+    };
+
+    /** Routines for integer solutions, as in `subtour_elim`. */
+    [[gnu::cold]]
+    static std::vector<separator<bool>> integer_separators() {
+        return {
+            { "components", [](std::span<const vertex> vertices, const utils::matrix<bool>& solution) -> size_t {
+                return tour::sub_tours(vertices, solution).size() > 1 ? 1 : 0;
+            } },
+            { "all-components", [](std::span<const vertex> vertices, const utils::matrix<bool>& solution) -> size_t {
+                const auto components = tour::sub_tours(vertices, solution);
+                return components.size() > 1 ? components.size() : 0;
+            } },
+            { "min-subtour", [](std::span<const vertex> vertices, const utils::matrix<bool>& solution) -> size_t {
+                return tour::min_sub_tour(vertices, solution).size() < vertices.size() ? 1 : 0;
+            } },
+        };
+    }
+
+    /** Routines for fractional points, as in `coupled_model::separate`. */
+    [[gnu::cold]]
+    static std::vector<separator<double>> fractional_separators() {
+        constexpr double EPSILON = 1e-6;
+        const auto copy = [](const utils::matrix<double>& weights) {
+            auto result = utils::matrix<double>(weights.size());
+            for (unsigned u = 0; u < weights.size(); u++) {
+                std::copy(weights[u].begin(), weights[u].end(), result[u].begin());
+            }
+            return result;
+        };
+        return {
+            { "min-cut", [copy](std::span<const vertex>, const utils::matrix<double>& weights) -> size_t {
+                const auto parts = min_cut::components(weights);
+                if (parts.size() > 1) {
+                    return parts.size();
+                }
+                const auto cut = min_cut::stoer_wagner(copy(weights));
+                return (cut.value < 2.0 - EPSILON && cut.side.size() > 1) ? 1 : 0;
+            } },
+            { "shrunk-min-cut", [](std::span<const vertex>, const utils::matrix<double>& weights) -> size_t {
+                const auto parts = min_cut::components(weights);
+                if (parts.size() > 1) {
+                    return parts.size();
+                }
+                const auto cut = min_cut::stoer_wagner(shrunk_graph::padberg_rinaldi(weights, EPSILON));
+                return (cut.value < 2.0 - EPSILON && cut.side.size() > 1) ? 1 : 0;
+            } },
+        };
+    }
+
+    /** Runs `sep` on every point, `repeat` times, and reports calls, cuts and time per call. */
+    template <typename Value> [[gnu::hot]]
+    void measure(const separator<Value>& sep, std::span<const vertex> vertices, const std::vector<utils::matrix<Value>>& points) const {
+        if (auto only = this->args.present<std::string>("separator"); only && *only != sep.name) {
+            return;
+        }
+        const unsigned repeat = std::max(this->args.get<unsigned>("repeat"), 1u);
+
+        size_t cuts = 0;
+        double total = 0.0, slowest = 0.0;
+        for (const auto& point : points) {
+            for (unsigned r = 0; r < repeat; r++) {
+                const auto start = std::chrono::steady_clock::now();
+                const size_t found = sep.separate(vertices, point);
+                const std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+                total += secs.count();
+                slowest = std::max(slowest, secs.count());
+                if (r == 0) {
+                    cuts += found;
+                }
+            }
+        }
+
+        const double calls = (double) points.size() * repeat;
+        std::cout << "Separator: " << sep.name << std::endl;
+        std::cout << "    Calls: " << points.size() << std::endl;
+        std::cout << "    Cuts: " << cuts << std::endl;
+        std::cout << "    Time per call: " << (calls > 0 ? 1e6 * total / calls : 0.0) << " usecs" << std::endl;
+        std::cout << "    Slowest call: " << 1e6 * slowest << " usecs" << std::endl;
+    }
+
+    [[gnu::cold]]
+    explicit inline program(std::string name): args(name) {
+        this->args.add_argument("trace")
+            .help("trace file written by 'modelo --record-trace'");
+
+        this->args.add_argument("--separator")
+            .help("only replay the routine with this name");
+
+        this->args.add_argument("--repeat")
+            .help("times each point is separated, for more stable timings")
+            .default_value<unsigned>(1)
+            .scan<'u', unsigned>();
+    }
+
+public:
+    [[gnu::cold]]
+    explicit program(const std::vector<std::string>& arguments): program(arguments[0]) {
+        try {
+            this->args.parse_args(arguments);
+
+        } catch (const std::runtime_error& err) {
+            std::cerr << err.what() << std::endl;
+            std::cerr << this->args << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    [[gnu::cold]]
+    void run() const {
+        auto reader = trace_reader(this->args.get<std::string>("trace"));
+        const unsigned n = reader.order();
+        // the separators only need the number of vertices, so any instance of that size will do,
+        // including traces of `modelo --generate` beyond the default vertices
+        const auto vertices = utils::random_vertices(n, 0);
+
+        // dense points are built before timing, each tour on its own
+        auto solutions = std::vector<utils::matrix<bool>>();
+        auto relaxations = std::vector<utils::matrix<double>>();
+        while (auto point = reader.next()) {
+            for (uint8_t i = 0; i <= 1; i++) {
+                if (point->type == trace_point::kind::solution) {
+                    solutions.push_back(point->solution(i, n));
+                } else {
+                    relaxations.push_back(point->weights(i, n));
+                }
+            }
+        }
+        std::cout << "Graph(n=" << n << ")" << std::endl;
+        std::cout << "Integer solutions: " << solutions.size() / 2 << std::endl;
+        std::cout << "Node relaxations: " << relaxations.size() / 2 << std::endl;
+
+        for (const auto& sep : integer_separators()) {
+            this->measure(sep, vertices, solutions);
+        }
+        for (const auto& sep : fractional_separators()) {
+            this->measure(sep, vertices, relaxations);
+        }
+    }
+};
+
+
+int main(int argc, const char * const argv[]) {
+    const program program(std::vector<std::string>(argv, argv + argc));
+
+    try {
+        program.run();
+
+    } catch (const std::exception& err) {
+        std::cerr << "std::exception: " << err.what() << std::endl;
+        return EXIT_FAILURE;
+
+    } catch (...) {
+        std::cerr << "unknown exception!" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+
+namespace utils {
+    [[gnu::pure]] [[gnu::cold]]
+    static inline std::optional<double> parse_double(std::string_view text) noexcept {
+        double value;
+        const auto end = text.data() + text.size();
+        const auto [ptr, err] = std::from_chars(text.data(), end, value);
+
+        if (err != std::errc() || ptr != end) [[unlikely]] {
+            return std::nullopt;
+        }
+        return value;
+    }
+}
+
+
+/**
+ * Ridge regression by the normal equations, accumulating `A^T A` and `A^T b` one sample at a
+ * time, so the samples themselves are not kept.
+ */
+template <size_t N>
+struct ridge_regression final {
+public:
+    using features = std::array<double, N>;
+
+private:
+    std::array<features, N> ata = {};
+    features atb = {};
+    size_t count = 0;
+
+    /** Solves `A x = b` by Gaussian elimination, with partial pivoting. */
+    [[gnu::cold]]
+    static std::optional<features> solve(std::array<features, N> a, features b) noexcept {
+        for (size_t col = 0; col < N; col++) {
+            size_t pivot = col;
+            for (size_t row = col + 1; row < N; row++) {
+                if (std::abs(a[row][col]) > std::abs(a[pivot][col])) {
+                    pivot = row;
+                }
+            }
+            if (std::abs(a[pivot][col]) < 1e-12) [[unlikely]] {
+                return std::nullopt;
+            }
+            std::swap(a[col], a[pivot]);
+            std::swap(b[col], b[pivot]);
+
+            for (size_t row = col + 1; row < N; row++) {
+                const double factor = a[row][col] / a[col][col];
+                for (size_t k = col; k < N; k++) {
+                    a[row][k] -= factor * a[col][k];
+                }
+                b[row] -= factor * b[col];
+            }
+        }
+
+        features x = {};
+        for (size_t row = N; row-- > 0;) {
+            double sum = b[row];
+            for (size_t k = row + 1; k < N; k++) {
+                sum -= a[row][k] * x[k];
+            }
+            x[row] = sum / a[row][row];
+        }
+        return x;
+    }
+
+public:
+    [[gnu::hot]] [[gnu::nothrow]]
+    void add(const features& x, double y) noexcept {
+        for (size_t i = 0; i < N; i++) {
+            for (size_t j = 0; j < N; j++) {
+                this->ata[i][j] += x[i] * x[j];
+            }
+            this->atb[i] += x[i] * y;
+        }
+        this->count++;
+    }
+
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline size_t samples() const noexcept {
+        return this->count;
+    }
+
+    /** Coefficients, with `ridge` per sample added to the diagonal. */
+    [[gnu::pure]] [[gnu::cold]]
+    std::optional<features> fit(double ridge) const noexcept {
+        auto a = this->ata;
+        for (size_t i = 0; i < N; i++) {
+            a[i][i] += ridge * this->count;
+        }
+        return solve(a, this->atb);
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    static double predict(const features& coefficients, const features& x) noexcept {
+        double y = 0.0;
+        for (size_t i = 0; i < N; i++) {
+            y += coefficients[i] * x[i];
+        }
+        return y;
+    }
+};
+
+
+/** A single run, stored as a set of `key=value` fields. */
+struct record final : public std::map<std::string, std::string> {
+public:
+    template <typename Value> [[gnu::cold]]
+    inline void set(const std::string& key, const Value& value) {
+        std::ostringstream buf;
+        buf << value;
+        (*this)[key] = buf.str();
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline std::optional<std::string> text(const std::string& key) const {
+        if (auto it = this->find(key); it != this->end()) {
+            return it->second;
+        }
+        return std::nullopt;
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline std::optional<double> number(const std::string& key) const {
+        if (auto value = this->text(key)) {
+            return utils::parse_double(*value);
+        }
+        return std::nullopt;
+    }
+
+    /** Parse a line in the store format: `key=value` fields separated by spaces. */
+    [[gnu::cold]]
+    static record parse(const std::string& line) {
+        auto rec = record();
+        auto fields = std::istringstream(line);
+
+        std::string field;
+        while (fields >> field) {
+            if (auto eq = field.find('='); eq != std::string::npos) [[likely]] {
+                rec[field.substr(0, eq)] = field.substr(eq + 1);
+            }
+        }
+        return rec;
+    }
+
+    /**
+     * Collect the `Key: value` lines printed by `modelo`.
+     *
+     * Keys are lowercased with spaces replaced by underscores, and the value kept is the first
+     * numeric word after the colon (or the first word, if none is numeric).
+     */
+    [[gnu::cold]]
+    static record from_report(std::istream& report) {
+        auto rec = record();
+
+        std::string line;
+        while (std::getline(report, line)) {
+            const auto colon = line.find(": ");
+            if (colon == std::string::npos || colon == 0) {
+                continue;
+            }
+
+            std::string key;
+            for (char c : line.substr(0, colon)) {
+                key.push_back((c == ' ') ? '_' : (char) std::tolower(c));
+            }
+
+            auto words = std::istringstream(line.substr(colon + 2));
+            std::optional<std::string> value;
+            std::string word;
+            while (words >> word) {
+                if (!value) {
+                    value = word;
+                }
+                if (utils::parse_double(word)) {
+                    value = word;
+                    break;
+                }
+            }
+            if (value) [[likely]] {
+                rec[key] = *value;
+            }
+        }
+        return rec;
+    }
+
+    [[gnu::cold]]
+    friend inline std::ostream& operator<<(std::ostream& os, const record& rec) {
+        bool first = true;
+        for (const auto& [key, value] : rec) {
+            if (!first) {
+                os << ' ';
+            }
+            os << key << '=' << value;
+            first = false;
+        }
+        return os;
+    }
+};
+
+
+/** Append-only text file of past runs, one record per line. */
+struct result_store final {
+public:
+    const std::string path;
+
+    [[gnu::cold]]
+    explicit inline result_store(std::string path): path(path) { }
+
+    /** All records in the store, or nothing if the file does not exist yet. */
+    [[gnu::cold]]
+    std::vector<record> load() const {
+        auto records = std::vector<record>();
+        auto file = std::ifstream(this->path);
+
+        std::string line;
+        while (std::getline(file, line)) {
+            if (!line.empty() && line[0] != '#') [[likely]] {
+                records.push_back(record::parse(line));
+            }
+        }
+        return records;
+    }
+
+    [[gnu::cold]]
+    void append(const record& rec) const {
+        auto file = std::ofstream(this->path, std::ios::app);
+        file << rec << std::endl;
+    }
+};
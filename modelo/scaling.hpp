@@ -0,0 +1,211 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "results.hpp"
+
+
+/**
+ * Strong-scaling summary: the same instances run at several thread counts, per component.
+ *
+ * Times of a component are combined by the geometric mean over the instances measured at every
+ * thread count, then compared to the smallest count. A count that is slower than the previous
+ * one is flagged.
+ */
+struct scaling_study final {
+public:
+    struct row final {
+        unsigned threads;
+        double secs;
+        double speedup;
+        /** Speedup over the increase in threads. */
+        double efficiency;
+        /** Slower than the previous thread count, beyond `TOLERANCE`. */
+        bool slower;
+    };
+
+    /** Relative slowdown ignored as noise. */
+    static constexpr double TOLERANCE = 0.05;
+    /** Floor for times, so components that barely ran do not dominate the means. */
+    static constexpr double MIN_SECS = 1e-3;
+
+private:
+    /** Seconds by component, instance and thread count. */
+    std::map<std::string, std::map<std::string, std::map<unsigned, double>>> times;
+
+public:
+    [[gnu::cold]]
+    void add(const std::string& component, const std::string& instance, unsigned threads, double secs) {
+        this->times[component][instance][threads] = std::max(secs, MIN_SECS);
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    std::vector<std::string> components() const {
+        auto names = std::vector<std::string>();
+        for (const auto& [name, _] : this->times) {
+            names.push_back(name);
+        }
+        return names;
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    std::vector<row> rows(const std::string& component) const {
+        const auto it = this->times.find(component);
+        if (it == this->times.end()) [[unlikely]] {
+            return {};
+        }
+
+        auto counts = std::vector<unsigned>();
+        for (const auto& [_, runs] : it->second) {
+            for (const auto& [threads, _] : runs) {
+                counts.push_back(threads);
+            }
+        }
+        std::sort(counts.begin(), counts.end());
+        counts.erase(std::unique(counts.begin(), counts.end()), counts.end());
+
+        auto rows = std::vector<row>();
+        for (unsigned threads : counts) {
+            double logs = 0.0;
+            size_t used = 0;
+            for (const auto& [_, runs] : it->second) {
+                if (runs.size() == counts.size()) {
+                    logs += std::log(runs.at(threads));
+                    used++;
+                }
+            }
+            if (used == 0) [[unlikely]] {
+                return {};
+            }
+            const double secs = std::exp(logs / used);
+            const double speedup = rows.empty() ? 1.0 : rows.front().secs / secs;
+            const double scale = (double) threads / counts.front();
+            const bool slower = !rows.empty() && secs > rows.back().secs * (1 + TOLERANCE);
+            rows.push_back(row { threads, secs, speedup, speedup / scale, slower });
+        }
+        return rows;
+    }
+
+    [[gnu::cold]]
+    friend std::ostream& operator<<(std::ostream& os, const scaling_study& study) {
+        auto flagged = std::vector<std::string>();
+        for (const auto& component : study.components()) {
+            os << "Scaling: " << component << std::endl;
+            for (const auto& row : study.rows(component)) {
+                os << "    " << row.threads << " thread(s): " << row.secs << " secs, speedup " << row.speedup
+                    << ", efficiency " << row.efficiency << (row.slower ? ", SLOWER" : "") << std::endl;
+                if (row.slower) {
+                    flagged.push_back(component + " at " + std::to_string(row.threads));
+                }
+            }
+        }
+        for (const auto& which : flagged) {
+            os << "Slower with more threads: " << which << std::endl;
+        }
+        return os;
+    }
+};
+
+
+/**
+ * Size-scaling summary: fits `value = c * n^b` by least squares on `log(value)` against
+ * `log(n)`, per component, so that `b` is the empirical growth exponent.
+ */
+struct growth_study final {
+public:
+    struct fit final {
+        double exponent;
+        double constant;
+        /** Coefficient of determination, on the log scale. */
+        double r2;
+        size_t samples;
+
+        [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+        inline double predict(double n) const noexcept {
+            return this->constant * std::pow(n, this->exponent);
+        }
+
+        /** Largest size predicted to stay within `limit`, or infinite if it never grows. */
+        [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+        inline double reach(double limit) const noexcept {
+            if (this->exponent <= 0 || limit <= 0) [[unlikely]] {
+                return INFINITY;
+            }
+            return std::pow(limit / this->constant, 1 / this->exponent);
+        }
+    };
+
+    /** Floor for values, so components that barely ran do not bend the fit. */
+    static constexpr double MIN_VALUE = 1e-3;
+
+private:
+    using regression = ridge_regression<2>;
+
+    /** Pairs of `log(n)` and `log(value)`, by component. */
+    std::map<std::string, std::vector<std::pair<double, double>>> samples;
+
+public:
+    [[gnu::cold]]
+    void add(const std::string& component, unsigned n, double value) {
+        this->samples[component].emplace_back(std::log(std::max(n, 1U)), std::log(std::max(value, MIN_VALUE)));
+    }
+
+    /** Fit for `component`, when it was measured on at least two sizes. */
+    [[gnu::pure]] [[gnu::cold]]
+    std::optional<fit> fitted(const std::string& component) const {
+        const auto it = this->samples.find(component);
+        if (it == this->samples.end()) [[unlikely]] {
+            return std::nullopt;
+        }
+        const auto& points = it->second;
+
+        auto normal = regression();
+        double mean = 0.0;
+        for (const auto& [x, y] : points) {
+            normal.add({ 1.0, x }, y);
+            mean += y;
+        }
+        mean /= points.size();
+        const auto coefficients = normal.fit(0.0);
+        if (!coefficients) {
+            return std::nullopt;
+        }
+
+        double residual = 0.0, total = 0.0;
+        for (const auto& [x, y] : points) {
+            const double error = y - regression::predict(*coefficients, { 1.0, x });
+            residual += error * error;
+            total += (y - mean) * (y - mean);
+        }
+        const double r2 = (total > 0) ? 1 - residual / total : 1.0;
+        return fit { (*coefficients)[1], std::exp((*coefficients)[0]), r2, points.size() };
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    std::vector<std::string> components() const {
+        auto names = std::vector<std::string>();
+        for (const auto& [name, _] : this->samples) {
+            names.push_back(name);
+        }
+        return names;
+    }
+
+    [[gnu::cold]]
+    friend std::ostream& operator<<(std::ostream& os, const growth_study& study) {
+        for (const auto& component : study.components()) {
+            if (const auto fit = study.fitted(component)) {
+                os << "Growth: " << component << " ~ n^" << fit->exponent
+                    << " (R^2 " << fit->r2 << ", " << fit->samples << " run(s))" << std::endl;
+            } else {
+                os << "Growth: " << component << " needs runs on two sizes or more" << std::endl;
+            }
+        }
+        return os;
+    }
+};
@@ -0,0 +1,346 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <fcntl.h>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <spawn.h>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "results.hpp"
+#include "vertex.hpp"
+
+extern char **environ;
+
+
+/** One `modelo` invocation of a batch grid. */
+struct job final {
+public:
+    unsigned nodes;
+    unsigned similarity;
+    /** Vertices per unit of area, averaged over both coordinate spaces. */
+    double density;
+    /** Extra arguments passed to `modelo`, as a single string. */
+    std::string args;
+    /** Predicted runtime, in seconds. */
+    double predicted = 0.0;
+
+    [[gnu::cold]]
+    job(std::span<const vertex> vertices, unsigned similarity, std::string args):
+        nodes((unsigned) vertices.size()), similarity(similarity),
+        density(job::point_density(vertices)), args(args)
+    { }
+
+    [[gnu::cold]]
+    explicit job(const record& rec):
+        nodes((unsigned) rec.number("n").value_or(0)), similarity((unsigned) rec.number("k").value_or(0)),
+        density(rec.number("density").value_or(0)), args(job::decode(rec.text("args").value_or("")))
+    { }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline double ratio() const noexcept {
+        return (this->nodes > 0) ? ((double) this->similarity / this->nodes) : 0.0;
+    }
+
+    /** Identifies runs of the same configuration across batches. */
+    [[gnu::pure]] [[gnu::cold]]
+    std::string key() const {
+        std::ostringstream buf;
+        buf << this->nodes << '/' << this->similarity << '/' << job::encode(this->args);
+        return buf.str();
+    }
+
+    [[gnu::cold]]
+    std::vector<std::string> argv(const std::string& modelo, double timeout) const {
+        auto argv = std::vector<std::string>{
+            modelo,
+            "--nodes", std::to_string(this->nodes),
+            "--similarity", std::to_string(this->similarity),
+            "--timeout", std::to_string(timeout),
+        };
+
+        auto words = std::istringstream(this->args);
+        std::string word;
+        while (words >> word) {
+            argv.push_back(word);
+        }
+        return argv;
+    }
+
+    [[gnu::cold]]
+    void describe(record& rec) const {
+        rec.set("n", this->nodes);
+        rec.set("k", this->similarity);
+        rec.set("density", this->density);
+        rec.set("args", job::encode(this->args));
+        rec.set("predicted", this->predicted);
+    }
+
+    [[gnu::cold]]
+    friend inline std::ostream& operator<<(std::ostream& os, const job& job) {
+        os << "n=" << job.nodes << " k=" << job.similarity;
+        if (!job.args.empty()) {
+            os << " [" << job.args << "]";
+        }
+        return os;
+    }
+
+private:
+    [[gnu::pure]] [[gnu::cold]]
+    static double point_density(std::span<const vertex> vertices) noexcept {
+        if (vertices.size() < 2) [[unlikely]] {
+            return 0.0;
+        }
+
+        double total = 0.0;
+        for (uint8_t i = 0; i <= 1; i++) {
+            double xmin = vertices[0][i].x(), xmax = xmin;
+            double ymin = vertices[0][i].y(), ymax = ymin;
+            for (const auto& v : vertices) {
+                xmin = std::min(xmin, v[i].x());
+                xmax = std::max(xmax, v[i].x());
+                ymin = std::min(ymin, v[i].y());
+                ymax = std::max(ymax, v[i].y());
+            }
+            const double area = std::max(1.0, (xmax - xmin) * (ymax - ymin));
+            total += vertices.size() / area;
+        }
+        return total / 2;
+    }
+
+    /** Store-safe form of the arguments (no spaces). */
+    [[gnu::cold]]
+    static std::string encode(std::string args) {
+        std::replace(args.begin(), args.end(), ' ', ',');
+        return args;
+    }
+
+    [[gnu::cold]]
+    static std::string decode(std::string args) {
+        std::replace(args.begin(), args.end(), ',', ' ');
+        return args;
+    }
+};
+
+
+/**
+ * Runtime predictor fitted on the result store.
+ *
+ * Configurations already seen use the geometric mean of their past runs. Otherwise, a ridge
+ * regression of `log(secs)` on the job features is used when there is enough history, with a
+ * fixed `n^3` prior as a last resort.
+ */
+struct runtime_model final {
+private:
+    static constexpr size_t FEATURES = 5;
+    using regression = ridge_regression<FEATURES>;
+    using features = regression::features;
+
+    [[gnu::pure]] [[gnu::cold]]
+    static features extract(const job& job) noexcept {
+        const double r = job.ratio();
+        return {
+            1.0,
+            std::log(std::max(job.nodes, 1U)),
+            r,
+            r * (1 - r),
+            std::log(std::max(job.density, 1e-9)),
+        };
+    }
+
+    std::optional<features> coefficients;
+    std::map<std::string, std::vector<double>> history;
+    size_t samples = 0;
+
+public:
+    /** Regularization weight for the ridge regression. */
+    static constexpr double RIDGE = 1e-3;
+
+    [[gnu::cold]]
+    explicit runtime_model(const std::vector<record>& records) {
+        auto normal = regression();
+
+        for (const auto& rec : records) {
+            const auto actual = rec.number("actual");
+            if (!actual || *actual <= 0 || rec.text("status") == "error") [[unlikely]] {
+                continue;
+            }
+            const auto run = job(rec);
+            const double y = std::log(*actual);
+            this->history[run.key()].push_back(y);
+            normal.add(runtime_model::extract(run), y);
+            this->samples++;
+        }
+
+        if (this->samples >= 2 * FEATURES) {
+            this->coefficients = normal.fit(RIDGE);
+        }
+    }
+
+    /** Number of past runs used in the fit. */
+    [[gnu::pure]] [[gnu::cold]]
+    inline size_t size() const noexcept {
+        return this->samples;
+    }
+
+    /** Predicted runtime, in seconds. */
+    [[gnu::pure]] [[gnu::cold]]
+    double predict(const job& job) const {
+        if (auto it = this->history.find(job.key()); it != this->history.end()) {
+            double mean = 0.0;
+            for (double y : it->second) {
+                mean += y;
+            }
+            return std::exp(mean / it->second.size());
+        }
+
+        if (this->coefficients) {
+            return std::exp(regression::predict(*this->coefficients, runtime_model::extract(job)));
+        }
+
+        const double scale = job.nodes / 100.0;
+        const bool coupled = job.similarity > 0 && job.similarity < job.nodes;
+        return scale * scale * scale * (coupled ? 8.0 : 1.0);
+    }
+};
+
+
+/** Longest-processing-time-first list scheduling of `modelo` runs over a fixed number of slots. */
+struct scheduler final {
+public:
+    const std::string modelo;
+    const unsigned slots;
+    /** Timeout for each run, in minutes. */
+    const double timeout;
+
+    [[gnu::cold]]
+    scheduler(std::string modelo, unsigned slots, double timeout):
+        modelo(modelo), slots(std::max(slots, 1U)), timeout(timeout)
+    { }
+
+    /** Sorts by predicted runtime, longest first, and returns the predicted makespan. */
+    [[gnu::cold]]
+    double plan(std::vector<job>& jobs) const {
+        std::stable_sort(jobs.begin(), jobs.end(), [](const job& a, const job& b) {
+            return a.predicted > b.predicted;
+        });
+
+        auto load = std::vector<double>(this->slots, 0.0);
+        for (const auto& job : jobs) {
+            *std::min_element(load.begin(), load.end()) += job.predicted;
+        }
+        return *std::max_element(load.begin(), load.end());
+    }
+
+    /** Runs the jobs in the given order, each on the first free slot. */
+    [[gnu::cold]]
+    std::vector<record> run(const std::vector<job>& jobs, const result_store& store, std::ostream& log) const {
+        auto records = std::vector<record>(jobs.size());
+        std::atomic<size_t> next = 0;
+        std::mutex lock;
+
+        auto worker = [&](unsigned slot) {
+            for (size_t idx = next++; idx < jobs.size(); idx = next++) {
+                auto rec = this->execute(jobs[idx]);
+                rec.set("slot", slot);
+
+                const std::lock_guard guard(lock);
+                store.append(rec);
+                log << jobs[idx] << ": predicted " << jobs[idx].predicted << " secs, actual "
+                    << rec.text("actual").value_or("?") << " secs (" << rec.text("status").value_or("?")
+                    << ", slot " << slot << ")" << std::endl;
+                records[idx] = std::move(rec);
+            }
+        };
+
+        auto threads = std::vector<std::thread>();
+        for (unsigned slot = 0; slot < std::min<size_t>(this->slots, jobs.size()); slot++) {
+            threads.emplace_back(worker, slot);
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        return records;
+    }
+
+private:
+    /** Spawns `modelo`, waits for it and parses its report. */
+    [[gnu::cold]]
+    record execute(const job& job) const {
+        const auto args = job.argv(this->modelo, this->timeout);
+        auto argv = std::vector<char *>();
+        for (const auto& arg : args) {
+            argv.push_back(const_cast<char *>(arg.c_str()));
+        }
+        argv.push_back(nullptr);
+
+        auto rec = record();
+        job.describe(rec);
+
+        int pipefd[2];
+        // close-on-exec, or children spawned by other slots would hold this write end open
+        if (pipe2(pipefd, O_CLOEXEC) != 0) [[unlikely]] {
+            rec.set("status", "error");
+            return rec;
+        }
+
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, pipefd[1], STDOUT_FILENO);
+        posix_spawn_file_actions_addclose(&actions, pipefd[0]);
+        posix_spawn_file_actions_addclose(&actions, pipefd[1]);
+
+        const auto start = std::chrono::steady_clock::now();
+        pid_t pid;
+        const int err = posix_spawn(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+        posix_spawn_file_actions_destroy(&actions);
+        close(pipefd[1]);
+
+        if (err != 0) [[unlikely]] {
+            close(pipefd[0]);
+            rec.set("status", "error");
+            return rec;
+        }
+
+        std::string output;
+        char buffer[4096];
+        for (ssize_t len; (len = read(pipefd[0], buffer, sizeof(buffer))) != 0;) {
+            if (len > 0) [[likely]] {
+                output.append(buffer, len);
+            } else if (errno != EINTR) [[unlikely]] {
+                break;
+            }
+        }
+        close(pipefd[0]);
+
+        int status = 0;
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR) { }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        auto report = std::istringstream(output);
+        rec.merge(record::from_report(report));
+        rec.set("actual", elapsed.count());
+
+        // checked first, since `modelo` stops cleanly and reports on its timeout
+        if (this->timeout > 0 && elapsed.count() >= this->timeout * 60) {
+            rec.set("status", "timeout");
+        } else if (WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS) [[likely]] {
+            rec.set("status", "ok");
+        } else {
+            rec.set("status", "error");
+        }
+        return rec;
+    }
+};
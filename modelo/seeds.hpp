@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <set>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "cuts.hpp"
+#include "neighbours.hpp"
+#include "repair.hpp"
+#include "tour.hpp"
+#include "vertex.hpp"
+
+
+/**
+ * Candidate subtour sets, added to the model before the solve as rows with the `Lazy` attribute
+ * instead of waiting for the callback to separate them.
+ *
+ * Each source has its own lazy level, by how likely its sets are to be violated: sets from a
+ * previous run were violated there, so they go into the root LP (3); segments of a good tour
+ * cut off the fractional solutions close to it (2); and spatial clusters are only checked
+ * against integer solutions (1), since most of them never bind.
+ */
+struct cut_seeds final {
+public:
+    enum class source : uint8_t {
+        clusters = 0,
+        segments = 1,
+        persisted = 2,
+    };
+
+    /** Set sizes tried, for both clusters and tour segments. */
+    static constexpr unsigned SIZES[] = { 4, 8, 16, 32 };
+
+    [[gnu::const]] [[gnu::cold]] [[gnu::nothrow]]
+    static constexpr int level(source from) noexcept {
+        switch (from) {
+            case source::clusters:
+                return 1;
+            case source::segments:
+                return 2;
+            case source::persisted:
+                return 3;
+        }
+        return 1;
+    }
+
+private:
+    std::span<const vertex> vertices;
+    std::set<cut_pool::key> seen;
+    std::vector<std::pair<cut_pool::key, int>> items;
+    size_t counts[3] = { 0, 0, 0 };
+
+    /** Keeps `set` unless repeated or unable to cut off any tour. */
+    [[gnu::cold]]
+    void add(source from, uint8_t i, std::vector<unsigned> set) {
+        if (set.size() < 2 || set.size() + 2 > this->vertices.size()) [[unlikely]] {
+            return;
+        }
+        std::sort(set.begin(), set.end());
+        auto key = cut_pool::key(i, std::move(set));
+        if (this->seen.insert(key).second) {
+            this->items.emplace_back(std::move(key), level(from));
+            this->counts[(uint8_t) from]++;
+        }
+    }
+
+public:
+    [[gnu::cold]]
+    explicit cut_seeds(std::span<const vertex> vertices): vertices(vertices) { }
+
+    /** For each vertex and space, the sets of its nearest vertices, up to half the instance. */
+    [[gnu::cold]]
+    void clusters() {
+        const unsigned n = (unsigned) this->vertices.size();
+        for (uint8_t i = 0; i <= 1; i++) {
+            const auto near = neighbours(i, this->vertices, std::min<size_t>(SIZES[std::size(SIZES) - 1], n / 2));
+            for (unsigned u = 0; u < n; u++) {
+                for (unsigned size : SIZES) {
+                    if (size > near.width + 1) {
+                        break;
+                    }
+                    auto set = std::vector<unsigned>(near[u].begin(), near[u].begin() + (size - 1));
+                    set.push_back(u);
+                    this->add(source::clusters, i, std::move(set));
+                }
+            }
+        }
+    }
+
+    /**
+     * Windows over a nearest-neighbour tour of each space, improved by local search, overlapping
+     * by half their length.
+     */
+    [[gnu::cold]]
+    void segments() {
+        const unsigned n = (unsigned) this->vertices.size();
+        if (n < 5) [[unlikely]] {
+            return;
+        }
+        const auto tours = similarity_repair::construct(this->vertices, 0);
+
+        for (uint8_t i = 0; i <= 1; i++) {
+            for (unsigned size : SIZES) {
+                if (size + 2 > n) {
+                    break;
+                }
+                for (unsigned from = 0; from < n; from += size / 2) {
+                    auto set = std::vector<unsigned>();
+                    set.reserve(size);
+                    for (unsigned j = 0; j < size; j++) {
+                        set.push_back(tours[i][(from + j) % n]);
+                    }
+                    this->add(source::segments, i, std::move(set));
+                }
+            }
+        }
+    }
+
+    /** Sets saved by `cut_pool::save` from a previous run over the same vertices. */
+    [[gnu::cold]]
+    void persisted(std::istream& is) {
+        for (auto& [i, set] : cut_pool::load(is, this->vertices)) {
+            this->add(source::persisted, i, std::move(set));
+        }
+    }
+
+    /** Sets with their lazy level, in the order found. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline std::span<const std::pair<cut_pool::key, int>> sets() const noexcept {
+        return this->items;
+    }
+
+    /** Sets kept from `from`, after removing repeated ones. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline size_t count(source from) const noexcept {
+        return this->counts[(uint8_t) from];
+    }
+};
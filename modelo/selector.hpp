@@ -0,0 +1,403 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "generator.hpp"
+#include "neighbours.hpp"
+#include "results.hpp"
+#include "vertex.hpp"
+
+
+/** Cheap statistics of an instance, for choosing how to solve it. */
+struct instance_features final {
+public:
+    /** Neighbours compared between spaces, for `overlap` and `correlation`. */
+    static constexpr size_t WIDTH = 8;
+
+    unsigned n;
+    unsigned k;
+    /** Mean distance to the nearest vertex, in each space. */
+    utils::pair<double> nn_mean;
+    /** Coefficient of variation of the nearest vertex distances, in each space. */
+    utils::pair<double> nn_cv;
+    /**
+     * Clark-Evans index in each space: mean nearest vertex distance over its expected value for
+     * uniform points in the bounding box. Below 1 for clustered points, above for regular ones.
+     */
+    utils::pair<double> clustering;
+    /** Fraction of the nearest vertices in one space that are also near in the other. */
+    double overlap;
+    /** Pearson correlation of edge costs between spaces, over the nearest neighbour edges. */
+    double correlation;
+
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline double ratio() const noexcept {
+        return (this->n > 0) ? ((double) this->k / this->n) : 0.0;
+    }
+
+    [[gnu::cold]]
+    static instance_features of(std::span<const vertex> vertices, unsigned k) {
+        const unsigned n = (unsigned) vertices.size();
+        auto features = instance_features { n, k, { 0, 0 }, { 0, 0 }, { 1, 1 }, 0, 0 };
+        if (n < 3) [[unlikely]] {
+            return features;
+        }
+
+        const auto near = utils::pair<neighbours> {
+            neighbours(0, vertices, WIDTH),
+            neighbours(1, vertices, WIDTH),
+        };
+        for (uint8_t i = 0; i <= 1; i++) {
+            double sum = 0.0, squares = 0.0;
+            double xmin = INFINITY, xmax = -INFINITY, ymin = INFINITY, ymax = -INFINITY;
+            for (unsigned u = 0; u < n; u++) {
+                const auto& p = vertices[u][i];
+                const double d = p.cost(vertices[near[i][u][0]][i]);
+                sum += d;
+                squares += d * d;
+                xmin = std::min(xmin, p.x());
+                xmax = std::max(xmax, p.x());
+                ymin = std::min(ymin, p.y());
+                ymax = std::max(ymax, p.y());
+            }
+            const double mean = sum / n;
+            const double variance = std::max(squares / n - mean * mean, 0.0);
+            const double area = std::max((xmax - xmin) * (ymax - ymin), 1e-9);
+
+            features.nn_mean[i] = mean;
+            features.nn_cv[i] = (mean > 0) ? std::sqrt(variance) / mean : 0.0;
+            features.clustering[i] = mean / (0.5 * std::sqrt(area / n));
+        }
+
+        size_t common = 0, edges = 0;
+        double sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0;
+        for (unsigned u = 0; u < n; u++) {
+            for (unsigned v : near[0][u]) {
+                common += std::count(near[1][u].begin(), near[1][u].end(), v);
+            }
+            for (uint8_t i = 0; i <= 1; i++) {
+                for (unsigned v : near[i][u]) {
+                    const double x = vertices[u][0].cost(vertices[v][0]);
+                    const double y = vertices[u][1].cost(vertices[v][1]);
+                    sx += x;
+                    sy += y;
+                    sxx += x * x;
+                    syy += y * y;
+                    sxy += x * y;
+                    edges++;
+                }
+            }
+        }
+        features.overlap = (double) common / (n * near[0].width);
+
+        const double cov = sxy / edges - (sx / edges) * (sy / edges);
+        const double vx = sxx / edges - (sx / edges) * (sx / edges);
+        const double vy = syy / edges - (sy / edges) * (sy / edges);
+        features.correlation = (vx > 0 && vy > 0) ? cov / std::sqrt(vx * vy) : 0.0;
+        return features;
+    }
+
+    [[gnu::cold]]
+    friend std::ostream& operator<<(std::ostream& os, const instance_features& f) {
+        os << "n=" << f.n << " k=" << f.k << " k/n=" << f.ratio();
+        for (uint8_t i = 0; i <= 1; i++) {
+            os << " nn" << i+1 << "=" << f.nn_mean[i] << "(cv " << f.nn_cv[i] << ")"
+               << " clustering" << i+1 << "=" << f.clustering[i];
+        }
+        return os << " overlap=" << f.overlap << " correlation=" << f.correlation;
+    }
+};
+
+
+/** A way of solving an instance: subtour formulation, edge coupling and heuristics. */
+struct engine final {
+public:
+    /** Formulation, for the quadratic coupling. */
+    std::string formulation = "lazy";
+    /** 'quadratic' for `graph`, 'edges' or 'paths' for `coupled_model`. */
+    std::string coupling = "quadratic";
+    bool relax_fix = false;
+
+    /** Every engine the selector chooses from. */
+    [[gnu::cold]]
+    static std::vector<engine> all() {
+        return {
+            engine { "lazy", "quadratic", false },
+            engine { "lazy", "quadratic", true },
+            engine { "flow", "quadratic", false },
+            engine { "mtz", "quadratic", false },
+            engine { "lazy", "edges", false },
+            engine { "lazy", "paths", false },
+        };
+    }
+
+    /** Short name, as printed by `modelo` in its `Engine:` line. */
+    [[gnu::pure]] [[gnu::cold]]
+    std::string name() const {
+        if (this->coupling != "quadratic") {
+            return this->coupling;
+        }
+        return this->relax_fix ? this->formulation + "+relax-fix" : this->formulation;
+    }
+
+    [[gnu::cold]]
+    static std::optional<engine> named(const std::string& name) {
+        for (const auto& option : engine::all()) {
+            if (option.name() == name) {
+                return option;
+            }
+        }
+        return std::nullopt;
+    }
+
+    /** The engine used by a run recorded from `modelo` arguments, when no `Engine:` line was saved. */
+    [[gnu::cold]]
+    static engine from_args(const std::string& args) {
+        auto used = engine();
+        auto words = std::istringstream(args);
+        std::string word;
+        while (words >> word) {
+            if (word == "-f" || word == "--formulation") {
+                words >> used.formulation;
+            } else if (word == "--coupling") {
+                words >> used.coupling;
+            } else if (word == "--relax-fix") {
+                used.relax_fix = true;
+            }
+        }
+        return used;
+    }
+};
+
+
+/**
+ * Chooses an engine from the instance features.
+ *
+ * Without trained rules, it goes by size: the exact MIP on small instances, the linear coupling
+ * on medium ones and relax-and-fix incumbents on large ones, unless the nearest neighbours in
+ * both spaces already agree enough for the coupling not to bind. The
+ * trained rules are a ridge regression of `log(secs)` on the features for each engine, fit on
+ * the batch result store, and the engine with the lowest prediction wins. The `k = 0` and
+ * `k = n` cases are structural and never left to the regression.
+ */
+struct engine_selector final {
+public:
+    static constexpr size_t FEATURES = 6;
+    using regression = ridge_regression<FEATURES>;
+
+    /** Largest instance solved by the exact MIP without other help. */
+    static constexpr unsigned SMALL = 60;
+    /** Largest instance where the linear coupling LP pays off. */
+    static constexpr unsigned MEDIUM = 150;
+    /** Timeouts count as this many times their time, as in PAR10. */
+    static constexpr double PENALTY = 10.0;
+    static constexpr double RIDGE = 1e-3;
+
+    struct selection final {
+        engine chosen;
+        std::vector<std::string> reasons;
+        /** Predicted seconds for each trained engine, by name. */
+        std::map<std::string, double> predicted;
+    };
+
+private:
+    std::map<std::string, regression::features> rules;
+    std::map<std::string, size_t> samples;
+
+    [[gnu::pure]] [[gnu::cold]]
+    static regression::features extract(const instance_features& f) noexcept {
+        const double r = f.ratio();
+        return {
+            1.0,
+            std::log(std::max(f.n, 1U)),
+            r,
+            r * (1 - r),
+            f.overlap,
+            std::log(std::max((f.clustering[0] + f.clustering[1]) / 2, 1e-3)),
+        };
+    }
+
+    [[gnu::cold]]
+    static engine builtin(const instance_features& f, std::vector<std::string>& reasons) {
+        if (f.n <= SMALL) {
+            reasons.push_back("n=" + std::to_string(f.n) + " <= " + std::to_string(SMALL) + ": the exact MIP closes small instances fastest");
+            return engine { "lazy", "quadratic", false };
+        }
+        if (f.overlap >= f.ratio()) {
+            reasons.push_back("neighbour overlap " + std::to_string(f.overlap) + " >= k/n: independent tours already share enough edges, so the coupling rarely binds");
+            if (f.n > MEDIUM) {
+                reasons.push_back("n > " + std::to_string(MEDIUM) + ": relax-and-fix supplies early incumbents");
+            }
+            return engine { "lazy", "quadratic", f.n > MEDIUM };
+        }
+        if (f.n <= MEDIUM) {
+            reasons.push_back("n <= " + std::to_string(MEDIUM) + " with a binding coupling: the linear edge coupling gives a stronger root bound");
+            return engine { "lazy", "edges", false };
+        }
+        reasons.push_back("n > " + std::to_string(MEDIUM) + " with a binding coupling: relax-and-fix supplies incumbents the MIP cannot find in time");
+        return engine { "lazy", "quadratic", true };
+    }
+
+    /** Seed of a run on a random instance, from its `--generate` and `--seed` arguments. */
+    [[gnu::pure]] [[gnu::cold]]
+    static std::optional<unsigned> generated_seed(const std::string& args) {
+        bool generate = false;
+        unsigned seed = 1;
+        auto words = std::istringstream(args);
+        std::string word;
+        while (words >> word) {
+            if (word == "--generate") {
+                generate = true;
+            } else if (word == "--seed") {
+                words >> seed;
+            }
+        }
+        return generate ? std::optional(seed) : std::nullopt;
+    }
+
+public:
+    /** Built-in rules only. */
+    engine_selector() = default;
+
+    /**
+     * Fits one regression per engine from the store records, computing the features of each
+     * record from the first `n` vertices of `pool`, as the batch grid runs them, or from the
+     * random instance it was run on, with `--generate`.
+     */
+    [[gnu::cold]]
+    static engine_selector train(const std::vector<record>& records, std::span<const vertex> pool) {
+        auto fits = std::map<std::string, regression>();
+        auto cache = std::map<std::tuple<unsigned, unsigned, std::optional<unsigned>>, regression::features>();
+
+        for (const auto& rec : records) {
+            const auto actual = rec.number("actual");
+            const auto status = rec.text("status");
+            const auto n = (unsigned) rec.number("n").value_or(0);
+            // stored with commas for spaces by `job::encode`
+            auto args = rec.text("args").value_or("");
+            std::replace(args.begin(), args.end(), ',', ' ');
+            const auto seed = generated_seed(args);
+            if (!actual || *actual <= 0 || status == "error" || n == 0 || (!seed && n > pool.size())) [[unlikely]] {
+                continue;
+            }
+            const auto k = (unsigned) rec.number("k").value_or(0);
+            const auto used = rec.text("engine").value_or(engine::from_args(args).name());
+            // such as flow+relax-fix: runnable, but not an engine `choose` picks or `load` accepts
+            if (!engine::named(used)) [[unlikely]] {
+                continue;
+            }
+
+            auto [it, inserted] = cache.try_emplace({ n, k, seed });
+            if (inserted) {
+                const auto features = seed
+                    ? instance_features::of(utils::random_vertices(n, *seed), k)
+                    : instance_features::of(pool.first(n), k);
+                it->second = extract(features);
+            }
+            const double secs = (status == "timeout") ? *actual * PENALTY : *actual;
+            fits[used].add(it->second, std::log(secs));
+        }
+
+        auto selector = engine_selector();
+        for (const auto& [name, fit] : fits) {
+            if (fit.samples() < FEATURES) {
+                continue;
+            }
+            if (auto coefficients = fit.fit(RIDGE)) [[likely]] {
+                selector.rules.emplace(name, *coefficients);
+                selector.samples.emplace(name, fit.samples());
+            }
+        }
+        return selector;
+    }
+
+    /** Reads rules written by `save`, or only the built-in rules if the file does not exist. */
+    [[gnu::cold]]
+    static engine_selector load(const std::string& path) {
+        auto selector = engine_selector();
+        for (const auto& rec : result_store(path).load()) {
+            const auto name = rec.text("engine");
+            if (!name || !engine::named(*name)) [[unlikely]] {
+                throw utils::invalid_file::contains_invalid_data(path);
+            }
+            auto coefficients = regression::features();
+            for (size_t i = 0; i < FEATURES; i++) {
+                const auto value = rec.number("c" + std::to_string(i));
+                if (!value) [[unlikely]] {
+                    throw utils::invalid_file::contains_invalid_data(path);
+                }
+                coefficients[i] = *value;
+            }
+            selector.rules[*name] = coefficients;
+            selector.samples[*name] = (size_t) rec.number("samples").value_or(0);
+        }
+        return selector;
+    }
+
+    /** Writes the trained rules in the result store format, one engine per line. */
+    [[gnu::cold]]
+    void save(std::ostream& os) const {
+        os << "# engine selection rules: log(secs) ~ c0 + c1 log(n) + c2 r + c3 r(1-r) + c4 overlap + c5 log(clustering)" << std::endl;
+        for (const auto& [name, coefficients] : this->rules) {
+            auto rec = record();
+            rec.set("engine", name);
+            rec.set("samples", this->samples.at(name));
+            for (size_t i = 0; i < FEATURES; i++) {
+                rec.set("c" + std::to_string(i), coefficients[i]);
+            }
+            os << rec << std::endl;
+        }
+    }
+
+    /** Number of engines with trained rules. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline size_t size() const noexcept {
+        return this->rules.size();
+    }
+
+    [[gnu::cold]]
+    selection choose(const instance_features& f) const {
+        auto result = selection();
+        const auto x = extract(f);
+        for (const auto& [name, coefficients] : this->rules) {
+            result.predicted[name] = std::exp(regression::predict(coefficients, x));
+        }
+
+        if (f.k == 0) {
+            result.reasons.push_back("k=0: no coupling, the model is two independent TSPs");
+            result.chosen = engine { "lazy", "quadratic", f.n > MEDIUM };
+            return result;
+        }
+        if (f.k >= f.n) {
+            result.reasons.push_back("k>=n: both tours must be equal, which the linear coupling states exactly");
+            result.chosen = engine { "lazy", "edges", false };
+            return result;
+        }
+
+        if (result.predicted.size() >= 2) {
+            const auto best = std::min_element(result.predicted.begin(), result.predicted.end(), [](const auto& a, const auto& b) {
+                return a.second < b.second;
+            });
+            if (const auto chosen = engine::named(best->first)) [[likely]] {
+                result.reasons.push_back("trained rules: lowest predicted time among " + std::to_string(result.predicted.size()) + " engines");
+                result.chosen = *chosen;
+                return result;
+            }
+        }
+        result.chosen = builtin(f, result.reasons);
+        return result;
+    }
+};
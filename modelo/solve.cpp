@@ -0,0 +1,130 @@
+#include <iostream>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "solver.hpp"
+#include "coordinates.hpp"
+#include "argparse.hpp"
+
+
+/** Minimal client of `solver::solve`, printing its progress reports and the structured result. */
+struct program final {
+private:
+    argparse::ArgumentParser args;
+
+    [[gnu::cold]]
+    explicit inline program(std::string name): args(name) {
+        this->args.add_argument("-n", "--nodes")
+            .help("sample size for the subgraph")
+            .default_value<unsigned>(100)
+            .scan<'u', unsigned>();
+
+        this->args.add_argument("-k", "--similarity")
+            .help("minimun number of shared edges between tours")
+            .default_value<unsigned>(0)
+            .scan<'u', unsigned>();
+
+        this->args.add_argument("-f", "--formulation")
+            .help("subtour elimination: 'lazy' constraints, single-commodity 'flow' or 'mtz'")
+            .default_value(std::string("lazy"));
+
+        this->args.add_argument("--time-limit")
+            .help("Gurobi time limit (in seconds)")
+            .scan<'g', double>();
+
+        this->args.add_argument("--threads")
+            .help("threads for the Gurobi model, or zero for its default")
+            .default_value<unsigned>(0)
+            .scan<'u', unsigned>();
+
+        this->args.add_argument("--memory")
+            .help("memory budget (in MiB) of the whole process: spill nodes and stop cleanly when approaching it")
+            .scan<'g', double>();
+
+        this->args.add_argument("--relax-fix")
+            .help("run the relax-and-fix heuristic alongside the solve")
+            .default_value(false)
+            .implicit_value(true);
+
+        this->args.add_argument("--heuristic-budget")
+            .help("time limit for the heuristic phase (in seconds)")
+            .scan<'g', double>();
+    }
+
+public:
+    [[gnu::cold]]
+    explicit program(const std::vector<std::string>& arguments): program(arguments[0]) {
+        try {
+            this->args.parse_args(arguments);
+
+        } catch (const std::runtime_error& err) {
+            std::cerr << err.what() << std::endl;
+            std::cerr << this->args << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    [[gnu::cold]]
+    void run() const {
+        const unsigned n = this->args.get<unsigned>("nodes");
+        if (n > DEFAULT_VERTICES.size()) [[unlikely]] {
+            throw utils::not_enough_items::in(DEFAULT_VERTICES, n);
+        }
+        const auto vertices = std::span(DEFAULT_VERTICES).first(n);
+
+        auto config = solver::config();
+        config.form = parse_formulation(this->args.get<std::string>("formulation"));
+        config.time_limit = this->args.present<double>("time-limit");
+        config.memory = this->args.present<double>("memory");
+        config.threads = this->args.get<unsigned>("threads");
+        config.relax_fix = this->args.get<bool>("relax-fix");
+        config.criteria.budget[(uint8_t) termination::phase::heuristic] = this->args.present<double>("heuristic-budget");
+
+        const auto instance = solver::instance {
+            std::vector<vertex>(vertices.begin(), vertices.end()),
+            this->args.get<unsigned>("similarity"),
+        };
+        const auto result = solver::solve(instance, config, solver::cancellation(), [](const solver::progress& now) {
+            std::cout << "Progress: " << now.secs << " secs, incumbent " << now.best << ", bound " << now.bound
+                << ", " << now.nodes << " nodes" << std::endl;
+        });
+
+        std::cout << "Found " << result.solutions << " solution(s)."  << std::endl;
+        std::cout << "Stop reason: " << result.stop << std::endl;
+        std::cout << "Execution time: " << result.secs << " secs" << std::endl;
+        std::cout << "Similarity: " << result.similarity << std::endl;
+        std::cout << "Objective cost: " << result.cost << std::endl;
+        std::cout << "Tour costs: " << result.tour_costs[0] << " " << result.tour_costs[1] << std::endl;
+        std::cout << "Best bound: " << result.bound << std::endl;
+        std::cout << "Optimality gap: " << result.gap << std::endl;
+        std::cout << "Subtour cuts: " << result.cuts << std::endl;
+        std::cout << "Patched solutions: " << result.patched << std::endl;
+    }
+};
+
+
+int main(int argc, const char * const argv[]) {
+    const program program(std::vector<std::string>(argv, argv + argc));
+
+    try {
+        program.run();
+
+    } catch (const utils::invalid_solution& err) {
+        std::cerr << "utils::invalid_solution: " << err.what() << std::endl;
+        return EXIT_FAILURE;
+
+    } catch (const std::exception& err) {
+        std::cerr << "std::exception: " << err.what() << std::endl;
+        return EXIT_FAILURE;
+
+    } catch (const GRBException& err) {
+        std::cerr << "GRBException: code " << err.getErrorCode() << ", " << err.getMessage() << std::endl;
+        return EXIT_FAILURE;
+
+    } catch (...) {
+        std::cerr << "unknown exception!" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <gurobi_c++.h>
+#include "graph.hpp"
+#include "mailbox.hpp"
+#include "memory.hpp"
+#include "relaxfix.hpp"
+#include "termination.hpp"
+#include "tour.hpp"
+#include "vertex.hpp"
+
+
+/**
+ * In-process entry point to the solver: `solve(instance, config)` instead of spawning `modelo`
+ * and parsing its output.
+ *
+ * Every call builds its own Gurobi environment and model, so calls from different threads are
+ * independent. Errors are thrown as in `modelo`: `utils::invalid_solution` when no solution was
+ * found, or `GRBException` from Gurobi.
+ *
+ * The memory budget is not per call: `memory_guard` samples the resident memory of the whole
+ * process, so concurrent calls with a budget all see each other's usage and should share one.
+ */
+namespace solver {
+    /** Vertices and minimum number of shared edges. */
+    struct instance final {
+        std::vector<vertex> vertices;
+        unsigned k = 0;
+    };
+
+    struct config final {
+        formulation form = formulation::lazy;
+        /** Suggest patched tours from solutions rejected by the callback. */
+        bool patching = true;
+        termination::criteria criteria = {};
+        /** Gurobi time limit, in seconds. */
+        std::optional<double> time_limit;
+        /** Memory budget in MiB of the whole process, for spilling nodes and shedding cuts. */
+        std::optional<double> memory;
+        std::string nodefile_dir = ".";
+        /** Gurobi threads, or its default when zero. */
+        unsigned threads = 0;
+        /** Gurobi random seed, or its default if empty. */
+        std::optional<int> seed;
+        /** Run the relax-and-fix heuristic alongside, limited by the heuristic phase budget. */
+        bool relax_fix = false;
+        /** Minimum seconds between progress reports, unless the incumbent or bound improve. */
+        double progress_interval = 1.0;
+    };
+
+    /** Snapshot passed to progress callbacks. */
+    struct progress final {
+        double secs;
+        double best;
+        double bound;
+        double nodes;
+    };
+
+    /** Shared flag to stop a running `solve`, possibly from another thread. */
+    struct cancellation final {
+    private:
+        std::shared_ptr<std::atomic<bool>> flag = std::make_shared<std::atomic<bool>>(false);
+
+    public:
+        [[gnu::cold]] [[gnu::nothrow]]
+        inline void cancel() const noexcept {
+            this->flag->store(true);
+        }
+
+        [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+        inline bool cancelled() const noexcept {
+            return this->flag->load();
+        }
+
+        [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+        inline const std::atomic<bool>& token() const noexcept {
+            return *this->flag;
+        }
+    };
+
+    struct result final {
+        termination::reason stop;
+        double cost;
+        double bound;
+        double gap;
+        double secs;
+        /** Both tours, as vertex ids. */
+        utils::pair<std::vector<unsigned>> tours;
+        utils::pair<double> tour_costs;
+        unsigned similarity;
+        int64_t solutions;
+        uint64_t cuts;
+        uint64_t patched;
+    };
+
+    [[gnu::cold]]
+    static GRBEnv environment(const config& config) {
+        auto env = GRBEnv(true);
+        env.set(GRB_IntParam_OutputFlag, 0);
+        env.set(GRB_IntParam_LazyConstraints, 1);
+        if (config.threads > 0) {
+            env.set(GRB_IntParam_Threads, (int) config.threads);
+        }
+        if (config.seed) {
+            env.set(GRB_IntParam_Seed, *config.seed);
+        }
+        env.start();
+        return env;
+    }
+
+    [[gnu::hot]]
+    static result solve(
+        const instance& instance,
+        const config& config,
+        const cancellation& token = cancellation(),
+        std::function<void(const progress&)> on_progress = nullptr
+    ) {
+        const auto start = std::chrono::steady_clock::now();
+        const auto elapsed = [&start]() {
+            const std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+            return secs.count();
+        };
+
+        const auto env = environment(config);
+        auto g = graph(instance.vertices, env, instance.k, config.form);
+        g.patching = config.patching;
+        g.time_limit(config.time_limit);
+
+        auto control = termination(config.criteria);
+        control.enter(termination::phase::heuristic);
+        control.watch(token.token());
+        auto guard = memory_guard::with_mebibytes(config.memory, config.nodefile_dir);
+
+        if (on_progress) {
+            auto last = progress { -INFINITY, INFINITY, -INFINITY, 0 };
+            g.progress = [&, last](double best, double bound, double nodes) mutable {
+                const double now = elapsed();
+                if (best < last.best || bound > last.bound || now - last.secs >= config.progress_interval) {
+                    last = progress { now, best, bound, nodes };
+                    on_progress(last);
+                }
+            };
+        }
+
+        auto inbox = mailbox();
+        auto heuristic = std::optional<relax_and_fix>();
+        if (config.relax_fix) {
+            heuristic.emplace(g.vertices, g.k, inbox, guard, config.criteria.budget[(uint8_t) termination::phase::heuristic],
+                config.threads, config.seed);
+            g.inbox = &inbox;
+        }
+
+        g.solve(control, guard);
+        if (heuristic) {
+            heuristic->stop();
+        }
+
+        auto outcome = result {
+            .stop = control.why(),
+            .cost = g.solution_cost(),
+            .bound = g.bound(),
+            .gap = g.gap(),
+            .secs = elapsed(),
+            .tours = {},
+            .tour_costs = {},
+            .similarity = g.similarity(),
+            .solutions = g.solution_count(),
+            .cuts = g.cuts.total(),
+            .patched = g.patched,
+        };
+        for (uint8_t i = 0; i <= 1; i++) {
+            const auto tour = g.tour(i);
+            outcome.tour_costs[i] = tour.cost(i, g.vertices);
+            for (unsigned v : tour) {
+                outcome.tours[i].push_back(g.vertices[v].id());
+            }
+        }
+        return outcome;
+    }
+}
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <optional>
+
+#include "interrupts.hpp"
+#include "vertex.hpp"
+
+
+/**
+ * Decides when a solve should stop before proving optimality, and why it stopped.
+ *
+ * Every instance also stops on `interrupts::stop`, so the first SIGINT or SIGTERM reaches any
+ * solve running in the process, in whatever mode.
+ */
+struct termination final {
+public:
+    enum class reason : uint8_t {
+        none,
+        optimal,
+        infeasible,
+        solver_limit,
+        target_gap,
+        target_objective,
+        stall,
+        node_limit,
+        phase_budget,
+        memory_limit,
+        cancelled,
+    };
+
+    enum class phase : uint8_t {
+        heuristic = 0,
+        exact = 1,
+    };
+
+    /** Stopping criteria, each one disabled when empty. */
+    struct criteria final {
+        /** Relative gap between incumbent and bound. */
+        std::optional<double> gap;
+        /** Incumbent cost (minimization). */
+        std::optional<double> objective;
+        /** Seconds without improving either the incumbent or the bound. */
+        std::optional<double> stall;
+        /** Explored branch-and-bound nodes. */
+        std::optional<double> nodes;
+        /** Seconds for each phase. */
+        utils::pair<std::optional<double>> budget;
+    };
+
+    const criteria limits;
+
+    /**
+     * Magnitude from which a cost or bound is treated as missing, the same as `GRB_INFINITY`.
+     *
+     * Checked explicitly because `-ffast-math` folds `std::isfinite` to true.
+     */
+    static constexpr double UNKNOWN = 1e100;
+
+    [[gnu::const]] [[gnu::hot]] [[gnu::nothrow]]
+    static inline bool known(double value) noexcept {
+        return std::abs(value) < UNKNOWN;
+    }
+
+    [[gnu::cold]]
+    explicit termination(criteria limits = criteria()) noexcept:
+        limits(limits), since(clock::now()), improved(clock::now())
+    { }
+
+    /** Stops on the next check after `flag` is set, possibly from another thread. */
+    [[gnu::cold]] [[gnu::nothrow]]
+    inline void watch(const std::atomic<bool>& flag) noexcept {
+        this->token = &flag;
+    }
+
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline reason why() const noexcept {
+        return this->stopped;
+    }
+
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline phase current() const noexcept {
+        return this->active;
+    }
+
+    /** Request a stop, keeping the first reason given. */
+    [[gnu::cold]] [[gnu::nothrow]]
+    inline void stop(reason why) noexcept {
+        if (this->stopped == reason::none) [[likely]] {
+            this->stopped = why;
+        }
+    }
+
+    [[gnu::cold]] [[gnu::nothrow]]
+    void enter(phase next) noexcept {
+        const auto now = clock::now();
+        this->spent[(uint8_t) this->active] += now - this->since;
+        this->active = next;
+        this->since = now;
+    }
+
+    /** Time spent on a phase so far, in seconds. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    double elapsed(phase p) const noexcept {
+        auto total = this->spent[(uint8_t) p];
+        if (p == this->active) {
+            total += clock::now() - this->since;
+        }
+        return std::chrono::duration<double>(total).count();
+    }
+
+    /**
+     * Update with the current state of the search and check every criterion.
+     *
+     * Returns true when the search should stop, with the reason available in `why()`.
+     */
+    [[gnu::hot]]
+    bool check(double best, double bound, double nodes) noexcept {
+        const bool interrupted = interrupts::stop.load(std::memory_order_relaxed);
+        if (interrupted || (this->token != nullptr && this->token->load(std::memory_order_relaxed))) [[unlikely]] {
+            this->stop(reason::cancelled);
+            return true;
+        }
+        const auto now = clock::now();
+        if (termination::better(best, this->best) || termination::better(this->bound, bound)) {
+            this->improved = now;
+        }
+        this->best = std::min(this->best, best);
+        this->bound = std::max(this->bound, bound);
+
+        const auto& limits = this->limits;
+        const bool bounded = termination::known(this->best) && termination::known(this->bound);
+        if (limits.gap && bounded && termination::gap(this->best, this->bound) <= *limits.gap) {
+            this->stop(reason::target_gap);
+
+        } else if (limits.objective && termination::known(this->best) && this->best <= *limits.objective) {
+            this->stop(reason::target_objective);
+
+        } else if (limits.stall && std::chrono::duration<double>(now - this->improved).count() >= *limits.stall) {
+            this->stop(reason::stall);
+
+        } else if (limits.nodes && nodes >= *limits.nodes) {
+            this->stop(reason::node_limit);
+
+        } else if (const auto budget = limits.budget[(uint8_t) this->active]) {
+            if (this->elapsed(this->active) >= *budget) {
+                this->stop(reason::phase_budget);
+            }
+        }
+        return this->stopped != reason::none;
+    }
+
+    /** Relative gap, as defined by Gurobi. */
+    [[gnu::const]] [[gnu::cold]] [[gnu::nothrow]]
+    static inline double gap(double best, double bound) noexcept {
+        if (!termination::known(best) || !termination::known(bound)) {
+            return INFINITY;
+        }
+        if (best == 0) {
+            return (bound == 0) ? 0 : INFINITY;
+        }
+        return std::abs(best - bound) / std::abs(best);
+    }
+
+    [[gnu::cold]]
+    friend inline std::ostream& operator<<(std::ostream& os, reason why) {
+        switch (why) {
+            case reason::none:
+                return os << "none";
+            case reason::optimal:
+                return os << "optimal";
+            case reason::infeasible:
+                return os << "infeasible";
+            case reason::solver_limit:
+                return os << "solver limit";
+            case reason::target_gap:
+                return os << "target gap";
+            case reason::target_objective:
+                return os << "target objective";
+            case reason::stall:
+                return os << "stall";
+            case reason::node_limit:
+                return os << "node limit";
+            case reason::phase_budget:
+                return os << "phase budget";
+            case reason::memory_limit:
+                return os << "memory limit";
+            case reason::cancelled:
+                return os << "cancelled";
+        }
+        return os << "unknown";
+    }
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    /** Improvement tolerance, relative to the previous value. */
+    static constexpr double EPSILON = 1e-9;
+
+    [[gnu::const]] [[gnu::hot]] [[gnu::nothrow]]
+    static inline bool better(double value, double previous) noexcept {
+        if (!termination::known(value)) {
+            return false;
+        }
+        if (!termination::known(previous)) {
+            return true;
+        }
+        return value < previous - EPSILON * std::max(1.0, std::abs(previous));
+    }
+
+    const std::atomic<bool> *token = nullptr;
+    reason stopped = reason::none;
+    phase active = phase::exact;
+    utils::pair<clock::duration> spent = { clock::duration::zero(), clock::duration::zero() };
+    clock::time_point since;
+    clock::time_point improved;
+    double best = INFINITY;
+    double bound = -INFINITY;
+};
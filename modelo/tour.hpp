@@ -1,7 +1,11 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <optional>
 #include <span>
+#include <utility>
 #include <vector>
 
 #include <gurobi_c++.h>
@@ -20,6 +24,20 @@ namespace utils {
             this->buffer = new Item[n * n];
         }
 
+        matrix(const matrix&) = delete;
+        matrix& operator=(const matrix&) = delete;
+
+        inline matrix(matrix&& other) noexcept: buffer(other.buffer), len(other.len) {
+            other.buffer = nullptr;
+            other.len = 0;
+        }
+
+        inline matrix& operator=(matrix&& other) noexcept {
+            std::swap(this->buffer, other.buffer);
+            std::swap(this->len, other.len);
+            return *this;
+        }
+
         inline ~matrix() {
             delete[] this->buffer;
         }
@@ -141,6 +159,133 @@ public:
         return min_tour;
     }
 
+    /** Every connected component of the solution, each one in cycle order. */
+    [[gnu::hot]]
+    static std::vector<tour> sub_tours(
+        std::span<const vertex> vertices,
+        const  utils::matrix<bool>& solution
+    ) {
+        iter_tours tours(vertices, solution);
+
+        auto all = std::vector<tour>();
+        while (auto tour = tours.next_tour()) [[likely]] {
+            all.push_back(std::move(*tour));
+        }
+        return all;
+    }
+
+    /**
+     * Joins disjoint cycles into a single Hamiltonian cycle, using cost space `i`.
+     *
+     * Karp's patching: the smallest cycle is repeatedly merged into another one by exchanging
+     * one edge of each for the cheapest pair of edges connecting them.
+     */
+    [[gnu::hot]]
+    static tour patch(uint8_t i, std::span<const vertex> vertices, std::vector<tour> cycles) {
+        const auto cost = [vertices, i](unsigned u, unsigned v) {
+            return vertices[u][i].cost(vertices[v][i]);
+        };
+
+        while (cycles.size() > 1) {
+            const auto smallest = std::min_element(cycles.begin(), cycles.end(), [](const tour& a, const tour& b) {
+                return a.size() < b.size();
+            });
+            const auto& c = *smallest;
+
+            double best = INFINITY;
+            size_t target = 0, x = 0, y = 0;
+            bool reversed = false;
+
+            for (size_t d = 0; d < cycles.size(); d++) {
+                if (cycles.begin() + d == smallest) [[unlikely]] {
+                    continue;
+                }
+                const auto& other = cycles[d];
+
+                for (size_t cx = 0; cx < c.size(); cx++) {
+                    const unsigned a = c[cx], a2 = c[(cx + 1) % c.size()];
+                    const double removed_a = cost(a, a2);
+
+                    for (size_t dy = 0; dy < other.size(); dy++) {
+                        const unsigned b = other[dy], b2 = other[(dy + 1) % other.size()];
+                        const double removed = removed_a + cost(b, b2);
+
+                        const double forward = cost(a, b2) + cost(b, a2) - removed;
+                        const double backward = cost(a, b) + cost(b2, a2) - removed;
+
+                        if (forward < best) [[unlikely]] {
+                            best = forward;
+                            target = d, x = cx, y = dy, reversed = false;
+                        }
+                        if (backward < best) [[unlikely]] {
+                            best = backward;
+                            target = d, x = cx, y = dy, reversed = true;
+                        }
+                    }
+                }
+            }
+
+            const auto& other = cycles[target];
+            auto merged = tour();
+            merged.reserve(c.size() + other.size());
+            merged.insert(merged.end(), c.begin(), c.begin() + x + 1);
+            for (size_t step = 1; step <= other.size(); step++) {
+                const size_t idx = reversed
+                    ? (y + other.size() + 1 - step) % other.size()
+                    : (y + step) % other.size();
+                merged.push_back(other[idx]);
+            }
+            merged.insert(merged.end(), c.begin() + x + 1, c.end());
+
+            cycles[target] = std::move(merged);
+            cycles.erase(smallest);
+        }
+
+        if (cycles.empty()) [[unlikely]] {
+            return tour();
+        }
+        return cycles.front();
+    }
+
+    /** Cost of the tour in space `i`, with vertices given by their position in `vertices`. */
+    [[gnu::pure]] [[gnu::hot]]
+    double cost(uint8_t i, std::span<const vertex> vertices) const noexcept {
+        double total_cost = 0.0;
+        for (unsigned v = 0; v < this->size(); v++) {
+            const unsigned next = (v + 1) % this->size();
+            total_cost += vertices[(*this)[v]][i].cost(vertices[(*this)[next]][i]);
+        }
+        return total_cost;
+    }
+
+    /** Successor of each vertex on the tour. */
+    [[gnu::pure]] [[gnu::hot]]
+    std::vector<unsigned> successors(size_t order) const {
+        auto next = std::vector<unsigned>(order, UINT32_MAX);
+        for (unsigned v = 0; v < this->size(); v++) {
+            next[(*this)[v]] = (*this)[(v + 1) % this->size()];
+        }
+        return next;
+    }
+
+    /** Number of edges present on both tours. */
+    [[gnu::pure]] [[gnu::hot]]
+    static unsigned shared(const tour& a, const tour& b, size_t order) {
+        if (a.size() < 3 || b.size() < 3) [[unlikely]] {
+            return 0;
+        }
+        const auto next = a.successors(order);
+
+        unsigned total = 0;
+        for (unsigned v = 0; v < b.size(); v++) {
+            const unsigned u = b[v], w = b[(v + 1) % b.size()];
+            if (next[u] == w || next[w] == u) {
+                total += 1;
+            }
+        }
+        return total;
+    }
+
     [[gnu::pure]] [[gnu::nothrow]]
     static double cost(uint8_t i, const std::vector<vertex>& tour) noexcept {
         double total_cost = 0.0;
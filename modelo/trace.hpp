@@ -0,0 +1,206 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tour.hpp"
+#include "vertex.hpp"
+
+
+/** A point seen by the separation callback: the support of both tours, by edge index. */
+struct trace_point final {
+public:
+    enum class kind : uint8_t {
+        /** Integer solution, at MIPSOL; every edge in the support has value 1. */
+        solution = 0,
+        /** Node relaxation, at MIPNODE. */
+        relaxation = 1,
+    };
+
+    kind type;
+    /** Edges `u * n + v`, with `u < v`, and their values, for each tour. */
+    utils::pair<std::vector<std::pair<uint32_t, double>>> support;
+
+    /** Dense weights of tour `i`, on `n` vertices. */
+    [[gnu::hot]]
+    utils::matrix<double> weights(uint8_t i, unsigned n) const {
+        auto weights = utils::matrix<double>(n);
+        for (unsigned u = 0; u < n; u++) {
+            for (unsigned v = 0; v < n; v++) {
+                weights[u][v] = 0.0;
+            }
+        }
+        for (const auto& [edge, value] : this->support[i]) {
+            weights[edge / n][edge % n] = weights[edge % n][edge / n] = value;
+        }
+        return weights;
+    }
+
+    /** Edges of tour `i` with value above one half, on `n` vertices. */
+    [[gnu::hot]]
+    utils::matrix<bool> solution(uint8_t i, unsigned n) const {
+        auto solution = utils::matrix<bool>(n);
+        for (unsigned u = 0; u < n; u++) {
+            for (unsigned v = 0; v < n; v++) {
+                solution[u][v] = false;
+            }
+        }
+        for (const auto& [edge, value] : this->support[i]) {
+            solution[edge / n][edge % n] = solution[edge % n][edge / n] = (value > 0.5);
+        }
+        return solution;
+    }
+};
+
+
+/**
+ * Binary trace of the points seen by the separation callback, to replay them offline.
+ *
+ * Starts with `MAGIC` and the number of vertices as 32 bits, then one record per point: its
+ * kind as a byte and, for each tour, the edge count as 32 bits followed by the edge indices
+ * and, for relaxations only, their values as doubles. Everything in native byte order.
+ */
+struct trace_writer final {
+public:
+    static constexpr std::array<char, 8> MAGIC = { 'k', 's', 't', 's', 'p', 't', 'r', '1' };
+
+private:
+    std::ofstream file;
+    std::mutex lock;
+    unsigned n;
+    uint64_t written = 0;
+
+    template <typename Item> [[gnu::hot]]
+    inline void put(Item item) {
+        this->file.write(reinterpret_cast<const char *>(&item), sizeof(Item));
+    }
+
+    template <typename Value, typename Take> [[gnu::hot]]
+    void record(trace_point::kind type, const utils::pair<utils::matrix<Value>>& points, Take&& take) {
+        auto guard = std::lock_guard(this->lock);
+        this->put((uint8_t) type);
+        for (uint8_t i = 0; i <= 1; i++) {
+            auto support = std::vector<std::pair<uint32_t, double>>();
+            for (unsigned u = 0; u < this->n; u++) {
+                for (unsigned v = u + 1; v < this->n; v++) {
+                    if (take(points[i][u][v])) {
+                        support.emplace_back(u * this->n + v, (double) points[i][u][v]);
+                    }
+                }
+            }
+            this->put((uint32_t) support.size());
+            for (const auto& [edge, value] : support) {
+                this->put(edge);
+                if (type == trace_point::kind::relaxation) {
+                    this->put(value);
+                }
+            }
+        }
+        this->written++;
+    }
+
+public:
+    [[gnu::cold]]
+    trace_writer(const std::string& path, unsigned n): file(path, std::ios::binary), n(n) {
+        if (!this->file) [[unlikely]] {
+            throw utils::invalid_file::is_empty_or_missing(path);
+        }
+        this->file.write(MAGIC.data(), MAGIC.size());
+        this->put((uint32_t) n);
+    }
+
+    [[gnu::hot]]
+    void solution(const utils::pair<utils::matrix<bool>>& solutions) {
+        this->record(trace_point::kind::solution, solutions, [](bool used) { return used; });
+    }
+
+    /** Records the node relaxation, without the edges at zero. */
+    [[gnu::hot]]
+    void relaxation(const utils::pair<utils::matrix<double>>& values) {
+        this->record(trace_point::kind::relaxation, values, [](double x) { return x > 1e-9; });
+    }
+
+    /** Points recorded so far. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline uint64_t size() const noexcept {
+        return this->written;
+    }
+};
+
+
+/** Reads the points of a trace written by `trace_writer`, in order. */
+struct trace_reader final {
+private:
+    std::ifstream file;
+    std::string path;
+    unsigned n = 0;
+
+    template <typename Item> [[gnu::hot]]
+    inline Item get() {
+        Item item;
+        if (!this->file.read(reinterpret_cast<char *>(&item), sizeof(Item))) [[unlikely]] {
+            throw utils::invalid_file::contains_invalid_data(this->path);
+        }
+        return item;
+    }
+
+public:
+    [[gnu::cold]]
+    explicit trace_reader(const std::string& path): file(path, std::ios::binary), path(path) {
+        auto magic = std::array<char, 8>();
+        if (!this->file.read(magic.data(), magic.size())) [[unlikely]] {
+            throw utils::invalid_file::is_empty_or_missing(path);
+        }
+        if (magic != trace_writer::MAGIC) [[unlikely]] {
+            throw utils::invalid_file::contains_invalid_data(path);
+        }
+        this->n = this->get<uint32_t>();
+        // no tour has fewer vertices, and edges are decoded by dividing by `n`
+        if (this->n < 3) [[unlikely]] {
+            throw utils::invalid_file::contains_invalid_data(path);
+        }
+    }
+
+    /** Number of vertices of the traced instance. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline unsigned order() const noexcept {
+        return this->n;
+    }
+
+    /** The next point, or nothing at the end of the trace. */
+    [[gnu::hot]]
+    std::optional<trace_point> next() {
+        uint8_t type;
+        if (!this->file.read(reinterpret_cast<char *>(&type), 1)) {
+            return std::nullopt;
+        }
+        if (type > (uint8_t) trace_point::kind::relaxation) [[unlikely]] {
+            throw utils::invalid_file::contains_invalid_data(this->path);
+        }
+
+        auto point = trace_point { (trace_point::kind) type, {} };
+        for (uint8_t i = 0; i <= 1; i++) {
+            const auto count = this->get<uint32_t>();
+            // a corrupt count must not reserve more than every edge of the graph
+            if (count > (uint64_t) this->n * (this->n - 1) / 2) [[unlikely]] {
+                throw utils::invalid_file::contains_invalid_data(this->path);
+            }
+            point.support[i].reserve(count);
+            for (uint32_t e = 0; e < count; e++) {
+                const auto edge = this->get<uint32_t>();
+                const double value = (point.type == trace_point::kind::relaxation) ? this->get<double>() : 1.0;
+                if (edge / this->n >= edge % this->n) [[unlikely]] {
+                    throw utils::invalid_file::contains_invalid_data(this->path);
+                }
+                point.support[i].emplace_back(edge, value);
+            }
+        }
+        return point;
+    }
+};
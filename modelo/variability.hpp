@@ -0,0 +1,187 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+/**
+ * Runtimes of configurations over several solver seeds on the same instances.
+ *
+ * Configurations are combined by the shifted geometric mean over every instance and seed, and
+ * compared to the first one. The comparison is repeated with each seed alone: when the faster
+ * configuration changes with the seed, the difference is within noise.
+ */
+struct variability_study final {
+public:
+    /** Spread of the runtimes of one configuration on one instance. */
+    struct spread final {
+        size_t runs;
+        double mean;
+        double median;
+        double stddev;
+        double min;
+        double max;
+
+        /** Standard deviation over the mean. */
+        [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+        inline double variation() const noexcept {
+            return (this->mean > 0) ? this->stddev / this->mean : 0.0;
+        }
+    };
+
+    struct row final {
+        std::string label;
+        double sgm;
+        /** Shifted geometric mean over the first configuration's, overall and per seed. */
+        double ratio;
+        double lowest;
+        double highest;
+        /** The faster configuration is not the same for every seed. */
+        bool noise;
+    };
+
+    /** Shift of the geometric means, in seconds, so that easy instances do not dominate. */
+    static constexpr double SHIFT = 10.0;
+
+private:
+    /** Seconds by instance, configuration and seed. */
+    std::map<std::string, std::map<std::string, std::map<unsigned, double>>> times;
+    std::vector<std::string> labels;
+
+    /** Instances measured on every configuration with every seed. */
+    [[gnu::pure]] [[gnu::cold]]
+    std::vector<std::string> complete() const {
+        auto seeds = std::vector<unsigned>();
+        for (const auto& [_, configs] : this->times) {
+            for (const auto& [_, runs] : configs) {
+                for (const auto& [seed, _] : runs) {
+                    seeds.push_back(seed);
+                }
+            }
+        }
+        std::sort(seeds.begin(), seeds.end());
+        const auto count = (size_t) (std::unique(seeds.begin(), seeds.end()) - seeds.begin());
+
+        auto instances = std::vector<std::string>();
+        for (const auto& [instance, configs] : this->times) {
+            const bool all = configs.size() == this->labels.size() && std::all_of(configs.begin(), configs.end(),
+                [count](const auto& config) { return config.second.size() == count; });
+            if (all) {
+                instances.push_back(instance);
+            }
+        }
+        return instances;
+    }
+
+    [[gnu::const]] [[gnu::cold]] [[gnu::nothrow]]
+    static inline double ratio(double secs, double base) noexcept {
+        return (base > 0) ? secs / base : 1.0;
+    }
+
+    /** Shifted geometric mean of `label` on `instances`, with one seed or all of them. */
+    [[gnu::pure]] [[gnu::cold]]
+    double sgm(const std::vector<std::string>& instances, const std::string& label, std::optional<unsigned> only) const {
+        double logs = 0.0;
+        size_t used = 0;
+        for (const auto& instance : instances) {
+            for (const auto& [seed, secs] : this->times.at(instance).at(label)) {
+                if (!only || seed == *only) {
+                    logs += std::log(secs + SHIFT);
+                    used++;
+                }
+            }
+        }
+        return (used > 0) ? std::exp(logs / used) - SHIFT : 0.0;
+    }
+
+public:
+    [[gnu::cold]]
+    void add(const std::string& instance, const std::string& label, unsigned seed, double secs) {
+        if (std::find(this->labels.begin(), this->labels.end(), label) == this->labels.end()) {
+            this->labels.push_back(label);
+        }
+        this->times[instance][label][seed] = std::max(secs, 0.0);
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    std::vector<std::pair<std::string, std::string>> measured() const {
+        auto pairs = std::vector<std::pair<std::string, std::string>>();
+        for (const auto& [instance, configs] : this->times) {
+            for (const auto& [label, _] : configs) {
+                pairs.emplace_back(instance, label);
+            }
+        }
+        return pairs;
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    spread of(const std::string& instance, const std::string& label) const {
+        auto secs = std::vector<double>();
+        for (const auto& [_, value] : this->times.at(instance).at(label)) {
+            secs.push_back(value);
+        }
+        std::sort(secs.begin(), secs.end());
+
+        const size_t n = secs.size();
+        double mean = 0.0;
+        for (double value : secs) {
+            mean += value / n;
+        }
+        double squares = 0.0;
+        for (double value : secs) {
+            squares += (value - mean) * (value - mean);
+        }
+        const double median = (n % 2 == 1) ? secs[n / 2] : (secs[n / 2 - 1] + secs[n / 2]) / 2;
+        const double stddev = (n > 1) ? std::sqrt(squares / (n - 1)) : 0.0;
+        return spread { n, mean, median, stddev, secs.front(), secs.back() };
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    std::vector<row> rows() const {
+        const auto instances = this->complete();
+        if (instances.empty() || this->labels.empty()) [[unlikely]] {
+            return {};
+        }
+        auto seeds = std::vector<unsigned>();
+        for (const auto& [seed, _] : this->times.at(instances.front()).at(this->labels.front())) {
+            seeds.push_back(seed);
+        }
+
+        const auto& baseline = this->labels.front();
+        const double base = this->sgm(instances, baseline, std::nullopt);
+        auto rows = std::vector<row>();
+        for (const auto& label : this->labels) {
+            const double sgm = this->sgm(instances, label, std::nullopt);
+            double lowest = INFINITY, highest = -INFINITY;
+            for (unsigned seed : seeds) {
+                const double change = ratio(this->sgm(instances, label, seed), this->sgm(instances, baseline, seed));
+                lowest = std::min(lowest, change);
+                highest = std::max(highest, change);
+            }
+            const bool noise = (label != baseline) && lowest <= 1.0 && highest >= 1.0;
+            rows.push_back(row { label, sgm, ratio(sgm, base), lowest, highest, noise });
+        }
+        return rows;
+    }
+
+    [[gnu::cold]]
+    friend std::ostream& operator<<(std::ostream& os, const variability_study& study) {
+        for (const auto& [instance, label] : study.measured()) {
+            const auto s = study.of(instance, label);
+            os << "Variability: " << instance << " " << label << ": mean " << s.mean << " secs, median " << s.median
+                << ", stddev " << s.stddev << " (cv " << s.variation() << "), range " << s.min << " to " << s.max
+                << ", " << s.runs << " seed(s)" << std::endl;
+        }
+        for (const auto& row : study.rows()) {
+            os << "Shifted geometric mean: " << row.label << ": " << row.sgm << " secs, ratio " << row.ratio
+                << " (per seed " << row.lowest << " to " << row.highest << ")" << (row.noise ? ", WITHIN NOISE" : "") << std::endl;
+        }
+        return os;
+    }
+};
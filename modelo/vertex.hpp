@@ -65,26 +65,36 @@ struct vertex final {
 public:
     struct point final {
     private:
-        double x;
-        double y;
+        double px;
+        double py;
 
     public:
         [[gnu::hot]] [[gnu::nothrow]]
-        constexpr inline point(double x, double y) noexcept: x(x), y(y) { }
+        constexpr inline point(double x, double y) noexcept: px(x), py(y) { }
+
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        constexpr inline double x() const noexcept {
+            return this->px;
+        }
+
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        constexpr inline double y() const noexcept {
+            return this->py;
+        }
 
         [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
         constexpr inline double cost(const point& other) const noexcept {
-            return ceil(hypot(this->x - other.x, this->y - other.y));
+            return ceil(hypot(this->px - other.px, this->py - other.py));
         }
 
         [[gnu::cold]]
         friend inline std::ostream& operator<<(std::ostream& os, const point& p) {
-            return os << p.x << ',' << p.y;
+            return os << p.px << ',' << p.py;
         }
 
         [[gnu::cold]]
         friend inline std::istream& operator>>(std::istream& is, point& p) {
-            return is >> p.x >> p.y;
+            return is >> p.px >> p.py;
         }
     };
 
@@ -121,12 +131,26 @@ public:
         return this->p[idx];
     }
 
+    /** Same vertex, with the point in cost space `idx` replaced by `q`. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    constexpr inline vertex with_point(std::uint8_t idx, const point& q) const noexcept {
+        auto copy = *this;
+        copy.p[idx] = q;
+        return copy;
+    }
+
     template <unsigned id> [[gnu::cold]]
     constexpr static vertex with_id(double x1, double y1, double x2, double y2) noexcept {
         static_assert(id > 0, "'id' must be positive.");
         return vertex(id, x1, y1, x2, y2);
     }
 
+    /** Same as `with_id<id>`, for identifiers only known at runtime, which must be positive. */
+    [[gnu::cold]]
+    static vertex with_id(unsigned id, double x1, double y1, double x2, double y2) noexcept {
+        return vertex(id, x1, y1, x2, y2);
+    }
+
     [[gnu::cold]]
     friend inline std::ostream& operator<<(std::ostream& os, const vertex& vertex) {
         return os << "v<" << vertex.id() << ">(" << vertex.p[0] << "," << vertex.p[1] << ")";